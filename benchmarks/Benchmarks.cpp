@@ -30,3 +30,484 @@ TEST_CASE ("Boot performance")
         });
     };
 }
+
+TEST_CASE ("Processing performance")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (48000.0, 512);
+
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midiBuffer;
+    juce::Random random (1);
+
+    fillWithNoise (buffer, random);
+
+    BENCHMARK ("processBlock (512 samples, stereo, 1024 FFT)")
+    {
+        plugin.processBlock (buffer, midiBuffer);
+        return buffer.getSample (0, 0);
+    };
+
+    {
+        // Compare against the run above: capture should cost no more than quantising the levels once
+        const auto captureFile = juce::File::createTempFile (".sgcap");
+        plugin.startCapture (captureFile);
+
+        BENCHMARK ("processBlock (512 samples, stereo, 1024 FFT) while capturing")
+        {
+            plugin.processBlock (buffer, midiBuffer);
+            return buffer.getSample (0, 0);
+        };
+
+        plugin.stopCapture();
+        captureFile.deleteFile();
+    }
+
+#if SPECTRAL_GATE_TRACING
+    // Compare against the run above to see what recording the stages costs
+    const auto traceFile = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("spectral-gate-benchmark-trace.json");
+    StageTracer tracer (traceFile);
+    tracer.start();
+
+    BENCHMARK ("processBlock (512 samples, stereo, 1024 FFT) while tracing")
+    {
+        plugin.processBlock (buffer, midiBuffer);
+        return buffer.getSample (0, 0);
+    };
+#endif
+}
+
+TEST_CASE ("Mask kernel performance")
+{
+    constexpr int numBins = 1024;
+    std::vector<float> power (numBins), gains (numBins);
+    juce::Random random (2);
+
+    for (auto& value : power)
+        value = std::pow (10.0f, -12.0f * random.nextFloat());
+
+    SpectralKernels::ExpanderCurve curve;
+
+    BENCHMARK ("Hard gate gains (1024 bins)")
+    {
+        SpectralKernels::gateGains (power.data(), gains.data(), numBins, 1.0e-3f, 0.5f);
+        return gains[0];
+    };
+
+    BENCHMARK ("Expander gains, fast log2/exp2 (1024 bins)")
+    {
+        SpectralKernels::expanderGains (power.data(), gains.data(), numBins, curve);
+        return gains[0];
+    };
+
+    // What the expander would cost with the standard library
+    BENCHMARK ("Expander gains, std::log10/std::pow (1024 bins)")
+    {
+        const float slope = curve.ratio - 1.0f;
+        const float halfKnee = 0.5f * curve.kneeDb;
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const float over = 10.0f * std::log10 (power[(size_t) bin] + 1.0e-30f) - curve.thresholdDb;
+            float gainDb = 0.0f;
+
+            if (over < -halfKnee)
+                gainDb = slope * over;
+            else if (over <= halfKnee)
+                gainDb = -slope * (over - halfKnee) * (over - halfKnee) / (4.0f * halfKnee);
+
+            gains[(size_t) bin] = std::pow (10.0f, std::max (gainDb, -curve.rangeDb) / 20.0f);
+        }
+
+        return gains[0];
+    };
+}
+
+TEST_CASE ("FFT performance")
+{
+    constexpr int order = 10;
+    constexpr int size = 1 << order;
+    std::vector<float> frame (size), real (size / 2 + 1), imag (size / 2 + 1);
+    juce::Random random (3);
+
+    for (auto& sample : frame)
+        sample = random.nextFloat() - 0.5f;
+
+    RealFFT realFFT (order);
+
+    BENCHMARK ("RealFFT forward and inverse (1024, N/2 + 1 split bins)")
+    {
+        realFFT.forward (frame.data(), real.data(), imag.data());
+        realFFT.inverse (real.data(), imag.data(), frame.data());
+        return frame[0];
+    };
+
+    // The interleaved real-only transform the STFT used before, on its double-length buffer
+    juce::dsp::FFT juceFFT (order);
+    std::vector<float> interleaved (2 * size);
+
+    BENCHMARK ("juce::dsp::FFT real-only forward and inverse (1024, interleaved)")
+    {
+        std::copy (frame.begin(), frame.end(), interleaved.begin());
+        juceFFT.performRealOnlyForwardTransform (interleaved.data(), true);
+        juceFFT.performRealOnlyInverseTransform (interleaved.data());
+        return interleaved[0];
+    };
+}
+
+TEST_CASE ("Stereo FFT performance")
+{
+    juce::Random random (5);
+
+    for (int order = PluginProcessor::minFFTOrder; order <= PluginProcessor::maxFFTOrder; ++order)
+    {
+        const int size = 1 << order;
+        const auto numBins = static_cast<size_t> (size / 2 + 1);
+        std::vector<float> left (static_cast<size_t> (size)), right (static_cast<size_t> (size));
+        std::vector<float> leftReal (numBins), leftImag (numBins), rightReal (numBins), rightImag (numBins);
+
+        for (auto* channel : { &left, &right })
+            for (auto& sample : *channel)
+                sample = random.nextFloat() - 0.5f;
+
+        RealFFT realFFT (order);
+        StereoFFT stereoFFT (order);
+        const auto sizeName = " (" + std::to_string (size) + ")";
+
+        // What a stereo frame cost before: two real transforms each way
+        BENCHMARK ("Two RealFFTs forward and inverse" + sizeName)
+        {
+            realFFT.forward (left.data(), leftReal.data(), leftImag.data());
+            realFFT.forward (right.data(), rightReal.data(), rightImag.data());
+            realFFT.inverse (leftReal.data(), leftImag.data(), left.data());
+            realFFT.inverse (rightReal.data(), rightImag.data(), right.data());
+            return left[0] + right[0];
+        };
+
+        BENCHMARK ("StereoFFT forward and inverse" + sizeName)
+        {
+            stereoFFT.forward (left.data(), right.data(), leftReal.data(), leftImag.data(), rightReal.data(), rightImag.data());
+            stereoFFT.inverse (leftReal.data(), leftImag.data(), rightReal.data(), rightImag.data(), left.data(), right.data());
+            return left[0] + right[0];
+        };
+    }
+}
+
+TEST_CASE ("Kernel variant performance")
+{
+    // One 2048-point frame's worth of kernel calls, for each variant this CPU can run.
+    // The frame and bins are refreshed every run so repeated gains never decay them into denormals.
+    constexpr int size = 2048;
+    constexpr int numBins = size / 2 + 1;
+    std::vector<float> source (size), frame (size), window (size), accumulator (size), dry (size);
+    std::vector<float> sourceBins (numBins), real (numBins), imag (numBins), power (numBins), gains (numBins);
+    juce::Random random (4);
+
+    for (auto* data : { &source, &window, &dry, &sourceBins })
+        for (auto& value : *data)
+            value = random.nextFloat() - 0.5f;
+
+    SpectralKernels::ExpanderCurve curve;
+
+    // The bin state engine, smoothing every bin as the processor does
+    std::vector<float> detection (numBins), smoothed (numBins, 1.0f);
+    std::vector<uint32_t> openBits (static_cast<size_t> (SpectralKernels::getNumStateWords (numBins)));
+    std::vector<int32_t> holdCounters (numBins);
+    SpectralKernels::GainSmoothing smoothing { 0.5f, 0.9f, 4 };
+
+    for (const auto* kernels : SpectralKernels::getSupportedKernels())
+    {
+        BENCHMARK (std::string (kernels->name) + " kernels, one frame (2048)")
+        {
+            std::copy (source.begin(), source.end(), frame.begin());
+            std::copy (sourceBins.begin(), sourceBins.end(), real.begin());
+            std::copy (sourceBins.begin(), sourceBins.end(), imag.begin());
+            std::fill (accumulator.begin(), accumulator.end(), 0.0f);
+
+            kernels->applyWindow (frame.data(), window.data(), size);
+            kernels->computePower (real.data(), imag.data(), power.data(), numBins);
+            kernels->hysteresisDetection (power.data(), detection.data(), openBits.data(), numBins, 4.0f);
+            kernels->expanderGains (detection.data(), gains.data(), numBins, curve);
+            kernels->updateOpenBits (detection.data(), openBits.data(), numBins, 1.0e-3f);
+            kernels->smoothGains (gains.data(), smoothed.data(), holdCounters.data(), numBins, smoothing);
+            kernels->applyGains (real.data(), imag.data(), gains.data(), numBins);
+            kernels->overlapAdd (accumulator.data(), frame.data(), 0.25f, size);
+            kernels->mixDryWet (accumulator.data(), dry.data(), 0.5f, size);
+            return accumulator[0];
+        };
+    }
+}
+
+//==============================================================================
+TEST_CASE ("Bin state performance")
+{
+    // One channel's gate state update for a 2048-point frame: hysteresis, gate gains, open bits, attack/hold/release
+    constexpr int numBins = 2048 / 2 + 1;
+    std::vector<float> power (numBins), detection (numBins), gains (numBins), smoothed (numBins, 1.0f);
+    std::vector<uint32_t> openBits (static_cast<size_t> (SpectralKernels::getNumStateWords (numBins)));
+    std::vector<int32_t> holdCounters (numBins);
+    juce::Random random (5);
+
+    // Powers either side of the threshold, so bins keep opening and closing
+    for (auto& value : power)
+        value = std::pow (10.0f, -1.0f - 4.0f * random.nextFloat());
+
+    SpectralKernels::GainSmoothing smoothing { 0.5f, 0.9f, 4 };
+
+    for (const auto* kernels : SpectralKernels::getSupportedKernels())
+    {
+        BENCHMARK (std::string (kernels->name) + " bin state, structure of arrays (1025 bins)")
+        {
+            kernels->hysteresisDetection (power.data(), detection.data(), openBits.data(), numBins, 4.0f);
+            kernels->gateGains (detection.data(), gains.data(), numBins, 1.0e-3f, 0.0f);
+            kernels->updateOpenBits (detection.data(), openBits.data(), numBins, 1.0e-3f);
+            kernels->smoothGains (gains.data(), smoothed.data(), holdCounters.data(), numBins, smoothing);
+            return gains[0];
+        };
+    }
+
+    // The same update written the obvious way, a struct per bin and a branch per decision
+    struct BinState
+    {
+        bool open = false;
+        float gain = 1.0f;
+        int hold = 0;
+    };
+
+    std::vector<BinState> bins (numBins);
+
+    BENCHMARK ("Bin state, struct per bin with branches (1025 bins)")
+    {
+        for (size_t bin = 0; bin < bins.size(); ++bin)
+        {
+            auto& state = bins[bin];
+            const float threshold = state.open ? 1.0e-3f / 4.0f : 1.0e-3f;
+            state.open = power[bin] >= threshold;
+            const float target = state.open ? 1.0f : 0.0f;
+
+            if (target >= state.gain)
+            {
+                state.gain = target + smoothing.attack * (state.gain - target);
+                state.hold = smoothing.holdHops;
+            }
+            else if (state.hold > 0)
+            {
+                --state.hold;
+            }
+            else
+            {
+                state.gain = target + smoothing.release * (state.gain - target);
+            }
+
+            gains[bin] = state.gain;
+        }
+
+        return gains[0];
+    };
+}
+
+namespace
+{
+    // Quiet stereo noise, so the spectrum has content and some bins are gated
+    void feedNoise (PluginProcessor& plugin, int numBlocks)
+    {
+        juce::AudioBuffer<float> buffer (2, 512);
+        juce::Random random (6);
+        processBlocks (plugin, buffer, numBlocks, [&] (juce::AudioBuffer<float>& input, int) { fillWithNoise (input, random, 0.05f); });
+    }
+
+    void prepareWithNoise (PluginProcessor& plugin, int fftSizeIndex)
+    {
+        plugin.setPlayConfigDetails (2, 2, 48000.0, 512);
+        plugin.prepareToPlay (48000.0, 512);
+        setParameter (plugin, "fftsize", static_cast<float> (fftSizeIndex));
+
+        // Enough for two of the largest frames after the size switch
+        feedNoise (plugin, 16);
+    }
+
+    // Offscreen render target for a component at a display scale
+    struct PaintTarget
+    {
+        PaintTarget (juce::Component& componentToPaint, float scale)
+            : component (componentToPaint),
+              image (juce::Image::ARGB, juce::roundToInt (static_cast<float> (component.getWidth()) * scale),
+                     juce::roundToInt (static_cast<float> (component.getHeight()) * scale), true),
+              graphics (image)
+        {
+            graphics.addTransform (juce::AffineTransform::scale (scale));
+        }
+
+        // One 30 Hz refresh: the whole component and its children, as the host would repaint it
+        void paintFrame() { component.paintEntireComponent (graphics, true); }
+
+        juce::Component& component;
+        juce::Image image;
+        juce::Graphics graphics;
+    };
+
+    std::string describeTarget (int width, int height, float scale, int fftSizeIndex)
+    {
+        return std::to_string (width) + "x" + std::to_string (height) + " @" + juce::String (scale, 1).toStdString()
+             + "x, " + std::to_string (64 << fftSizeIndex) + " FFT";
+    }
+}
+
+TEST_CASE ("Spectrum paint performance")
+{
+    // The editor's own size, then double it for large or resized windows
+    const std::vector<std::pair<int, int>> sizes { { 880, 160 }, { 1760, 320 } };
+
+    for (int fftSizeIndex = 0; fftSizeIndex < 6; ++fftSizeIndex)
+    {
+        PluginProcessor plugin;
+        prepareWithNoise (plugin, fftSizeIndex);
+        SpectrumAnalyzer analyzer (plugin);
+
+        for (const auto& [width, height] : sizes)
+        {
+            analyzer.setSize (width, height);
+
+            for (const float scale : { 1.0f, 2.0f })
+            {
+                PaintTarget target (analyzer, scale);
+                BENCHMARK ("SpectrumAnalyzer paint (" + describeTarget (width, height, scale, fftSizeIndex) + ")")
+                {
+                    target.paintFrame();
+                    return target.image.getWidth();
+                };
+            }
+        }
+    }
+}
+
+TEST_CASE ("Editor paint performance")
+{
+    for (int fftSizeIndex = 0; fftSizeIndex < 6; ++fftSizeIndex)
+    {
+        PluginProcessor plugin;
+        prepareWithNoise (plugin, fftSizeIndex);
+        std::unique_ptr<juce::AudioProcessorEditor> editor (plugin.createEditorIfNeeded());
+
+        for (const float scale : { 1.0f, 2.0f })
+        {
+            PaintTarget target (*editor, scale);
+            BENCHMARK ("PluginEditor paint (" + describeTarget (editor->getWidth(), editor->getHeight(), scale, fftSizeIndex) + ")")
+            {
+                target.paintFrame();
+                return target.image.getWidth();
+            };
+        }
+    }
+}
+
+TEST_CASE ("Multi-editor paint performance")
+{
+    // A session with several instances open: every editor repaints on the same message thread
+    constexpr int numEditors = 8;
+    std::vector<std::unique_ptr<PluginProcessor>> plugins;
+    std::vector<std::unique_ptr<juce::AudioProcessorEditor>> editors;
+    std::vector<std::unique_ptr<PaintTarget>> targets;
+
+    for (int i = 0; i < numEditors; ++i)
+    {
+        plugins.push_back (std::make_unique<PluginProcessor>());
+        prepareWithNoise (*plugins.back(), 4);
+        editors.emplace_back (plugins.back()->createEditorIfNeeded());
+        targets.push_back (std::make_unique<PaintTarget> (*editors.back(), 1.0f));
+    }
+
+    const auto paintAll = [&] {
+        for (auto& target : targets)
+            target->paintFrame();
+    };
+
+    BENCHMARK (std::to_string (numEditors) + " PluginEditors paint (" + describeTarget (editors.front()->getWidth(), editors.front()->getHeight(), 1.0f, 4) + ")")
+    {
+        paintAll();
+        return targets.front()->image.getWidth();
+    };
+}
+
+TEST_CASE ("Adaptive quality performance")
+{
+    // processBlock at every rung of the ladder below a 1024 FFT
+    PluginProcessor plugin;
+    prepareWithNoise (plugin, 4);
+
+    setParameter (plugin, "quality", 1.0f);
+    setParameter (plugin, "cpubudget", 1.0f);
+
+    auto& scheduler = plugin.getQualityScheduler();
+    const double blockSeconds = 512.0 / 48000.0;
+
+    // Processing in place would feed each run the last one's output, so every run starts from the same noise
+    juce::AudioBuffer<float> noise (2, 512), buffer (2, 512);
+    juce::MidiBuffer midiBuffer;
+    juce::Random random (1);
+
+    fillWithNoise (noise, random);
+
+    for (int level = 0; level < scheduler.getNumLevels(); ++level)
+    {
+        // Step down as if overloaded, then let the switch happen
+        while (scheduler.getLevel() < level)
+            scheduler.addBlock (10.0 * blockSeconds, blockSeconds, 1.0, 10);
+
+        feedNoise (plugin, 8);
+
+        const auto configuration = QualityScheduler::getConfiguration (10, level);
+        const std::string name = "processBlock (512 samples, stereo), level " + std::to_string (level) + ": "
+                               + std::to_string (configuration.getSize()) + " FFT, hop " + std::to_string (configuration.getHopSize());
+
+        BENCHMARK (name)
+        {
+            buffer.makeCopyOf (noise, true);
+            plugin.processBlock (buffer, midiBuffer);
+
+            // A block at 1.6 times the deadline after each real one keeps the average between the
+            // step-down and step-up thresholds, so the level holds for the whole run
+            scheduler.addBlock (1.6 * blockSeconds, blockSeconds, 1.0, 10);
+            return buffer.getSample (0, 0);
+        };
+    }
+}
+
+TEST_CASE ("Frequency range performance")
+{
+    // processBlock at 2048 points with the expander, as the band narrows: the mask, its state and
+    // the gains run over the band only, the FFTs over everything
+    PluginProcessor plugin;
+    prepareWithNoise (plugin, 5);
+
+    setParameter (plugin, "mode", 1.0f);
+
+    juce::AudioBuffer<float> noise (2, 512), buffer (2, 512);
+    juce::MidiBuffer midiBuffer;
+    juce::Random random (1);
+
+    fillWithNoise (noise, random);
+
+    const std::array<std::pair<float, float>, 5> bands { { { 0.0f, PluginProcessor::maxLimitHz },
+                                                           { 0.0f, 12000.0f },
+                                                           { 4000.0f, 16000.0f },
+                                                           { 0.0f, 6000.0f },
+                                                           { 0.0f, 1500.0f } } };
+
+    for (const auto& [low, high] : bands)
+    {
+        setParameter (plugin, "lowfreq", low);
+        setParameter (plugin, "highfreq", high);
+
+        const auto activeBins = plugin.getActiveBins (2048 / 2 + 1);
+        const std::string name = "processBlock (512 samples, stereo, 2048 FFT), " + std::to_string (juce::roundToInt (low)) + "-"
+                               + std::to_string (juce::roundToInt (high)) + " Hz, " + std::to_string (activeBins.getLength()) + " bins";
+
+        BENCHMARK (name)
+        {
+            buffer.makeCopyOf (noise, true);
+            plugin.processBlock (buffer, midiBuffer);
+            return buffer.getSample (0, 0);
+        };
+    }
+}
@@ -17,6 +17,7 @@ int main (int argc, char* argv[])
 }
 
 #include "PluginEditor.h"
+#include "helpers/test_helpers.h"
 #include "catch2/benchmark/catch_benchmark_all.hpp"
 #include "catch2/catch_test_macros.hpp"
 
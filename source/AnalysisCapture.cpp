@@ -0,0 +1,190 @@
+#include "AnalysisCapture.h"
+#include <cstring>
+
+AnalysisCaptureWriter::AnalysisCaptureWriter (SpectrogramFrameRing& ringToDrain, const juce::File& captureFile, const AnalysisCapture::Format& captureFormat)
+    : juce::Thread ("Analysis capture writer"),
+      ring (ringToDrain),
+      file (captureFile),
+      format (captureFormat),
+      maxBins (ringToDrain.getMaxBins()),
+      frameBytes (AnalysisCapture::getFrameBytes (ringToDrain.getMaxBins()))
+{
+}
+
+AnalysisCaptureWriter::~AnalysisCaptureWriter()
+{
+    ring.setConsumerActive (false);
+    stopThread (2000);
+
+    if (mapping == nullptr)
+        return;
+
+    drain();
+
+    const auto finalSize = static_cast<int64_t> (sizeof (AnalysisCapture::FileHeader)) + numFramesWritten.load() * frameBytes;
+    mapping.reset();
+
+    // Drop the unused tail left by the last growth step
+    juce::FileOutputStream stream (file);
+    if (stream.openedOk())
+    {
+        stream.setPosition (finalSize);
+        stream.truncate();
+    }
+}
+
+bool AnalysisCaptureWriter::start()
+{
+    if (mapping != nullptr)
+        return true;
+
+    file.deleteFile();
+
+    if (! file.create() || ! mapWithCapacity (4096))
+        return false;
+
+    auto& header = getHeader();
+    std::copy (std::begin (AnalysisCapture::magic), std::end (AnalysisCapture::magic), header.magic);
+    header.version = AnalysisCapture::currentVersion;
+    header.headerBytes = sizeof (AnalysisCapture::FileHeader);
+    header.frameBytes = static_cast<uint32_t> (frameBytes);
+    header.maxBins = static_cast<uint32_t> (maxBins);
+    header.fftSize = static_cast<uint32_t> (format.fftSize);
+    header.hopSize = static_cast<uint32_t> (format.hopSize);
+    header.sampleRate = format.sampleRate;
+    header.floorDecibels = SpectrogramFrameRing::floorDecibels;
+    header.flags = 0;
+    header.numFrames = 0;
+    header.numDropped = 0;
+
+    // Anything left in the ring predates this capture
+    ring.discardAllBut (0);
+    droppedAtStart = ring.getNumDropped();
+    ring.setConsumerActive (true);
+
+    startThread();
+    return true;
+}
+
+//==============================================================================
+void AnalysisCaptureWriter::run()
+{
+    while (! threadShouldExit())
+    {
+        drain();
+        wait (10);
+    }
+}
+
+void AnalysisCaptureWriter::drain()
+{
+    const int numReady = ring.getNumReady();
+    const int64_t firstFrame = numFramesWritten.load();
+
+    if (numReady > 0 && firstFrame + numReady > capacityInFrames)
+    {
+        // Out of disk or address space: stop capturing rather than retrying every drain
+        if (! mapWithCapacity (juce::jmax (capacityInFrames * 2, firstFrame + numReady)))
+        {
+            ring.setConsumerActive (false);
+            signalThreadShouldExit();
+            return;
+        }
+    }
+
+    auto* frames = static_cast<char*> (mapping->getData()) + sizeof (AnalysisCapture::FileHeader);
+    int64_t frameIndex = firstFrame;
+
+    ring.drain (numReady, [&] (const SpectrogramFrameRing::Frame& frame) {
+        auto* record = frames + frameIndex * frameBytes;
+        const AnalysisCapture::FrameRecordHeader recordHeader { frame.position, static_cast<uint32_t> (frame.numBins), static_cast<uint32_t> (frame.hopSize) };
+        std::memcpy (record, &recordHeader, sizeof (recordHeader));
+
+        auto* levels = record + sizeof (recordHeader);
+        std::memcpy (levels, frame.levels, static_cast<size_t> (frame.numBins));
+        std::memset (levels + frame.numBins, 0, static_cast<size_t> (AnalysisCapture::getLevelBytes (maxBins) - frame.numBins));
+
+        const int usedWords = (frame.numBins + 31) / 32;
+        const int maskWords = (maxBins + 31) / 32;
+        auto* mask = levels + AnalysisCapture::getLevelBytes (maxBins);
+        std::memcpy (mask, frame.gateMask, static_cast<size_t> (usedWords) * 4);
+        std::memset (mask + usedWords * 4, 0, static_cast<size_t> (maskWords - usedWords) * 4);
+
+        ++frameIndex;
+    });
+
+    auto& header = getHeader();
+    header.numDropped = static_cast<uint64_t> (ring.getNumDropped() - droppedAtStart);
+
+    // Published last, so a reader that sees the count also sees the frames
+    std::atomic_thread_fence (std::memory_order_release);
+    header.numFrames = static_cast<uint64_t> (frameIndex);
+    numFramesWritten.store (frameIndex);
+}
+
+bool AnalysisCaptureWriter::mapWithCapacity (int64_t numFrames)
+{
+    const auto newSize = static_cast<int64_t> (sizeof (AnalysisCapture::FileHeader)) + numFrames * frameBytes;
+    mapping.reset();
+
+    {
+        // Writing the last byte extends the file (sparsely, where supported)
+        juce::FileOutputStream stream (file);
+        if (! stream.openedOk() || ! stream.setPosition (newSize - 1) || ! stream.writeByte (0))
+            return false;
+    }
+
+    mapping = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readWrite, false);
+
+    if (mapping->getData() == nullptr || static_cast<int64_t> (mapping->getSize()) < newSize)
+    {
+        mapping.reset();
+        return false;
+    }
+
+    capacityInFrames = numFrames;
+    return true;
+}
+
+AnalysisCapture::FileHeader& AnalysisCaptureWriter::getHeader() noexcept
+{
+    return *static_cast<AnalysisCapture::FileHeader*> (mapping->getData());
+}
+
+//==============================================================================
+AnalysisCaptureReader::AnalysisCaptureReader (const juce::File& file)
+    : mapping (std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly, false))
+{
+    const auto size = static_cast<int64_t> (mapping->getSize());
+
+    if (mapping->getData() == nullptr || size < static_cast<int64_t> (sizeof (AnalysisCapture::FileHeader)))
+        return;
+
+    const auto* candidate = static_cast<const AnalysisCapture::FileHeader*> (mapping->getData());
+
+    if (std::memcmp (candidate->magic, AnalysisCapture::magic, sizeof (AnalysisCapture::magic)) != 0
+        || candidate->version != AnalysisCapture::currentVersion
+        || candidate->headerBytes != sizeof (AnalysisCapture::FileHeader)
+        || candidate->frameBytes != static_cast<uint32_t> (AnalysisCapture::getFrameBytes (static_cast<int> (candidate->maxBins))))
+        return;
+
+    header = candidate;
+
+    // Never index past the mapping, even if the header claims more
+    const auto framesInFile = (size - static_cast<int64_t> (header->headerBytes)) / header->frameBytes;
+    numFrames = juce::jmin (framesInFile, static_cast<int64_t> (header->numFrames));
+}
+
+SpectrogramFrameRing::Frame AnalysisCaptureReader::getFrame (int64_t index) const noexcept
+{
+    jassert (isValid() && index >= 0 && index < numFrames);
+
+    const auto* record = static_cast<const char*> (mapping->getData()) + header->headerBytes + index * header->frameBytes;
+    AnalysisCapture::FrameRecordHeader recordHeader;
+    std::memcpy (&recordHeader, record, sizeof (recordHeader));
+
+    const auto* levels = reinterpret_cast<const uint8_t*> (record + sizeof (recordHeader));
+    const auto* mask = reinterpret_cast<const uint32_t*> (levels + AnalysisCapture::getLevelBytes (static_cast<int> (header->maxBins)));
+
+    return { static_cast<int> (juce::jmin (recordHeader.numBins, header->maxBins)), recordHeader.position, static_cast<int> (recordHeader.hopSize), levels, mask };
+}
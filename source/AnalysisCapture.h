@@ -0,0 +1,143 @@
+#pragma once
+
+#include "SpectrogramFrameRing.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+//==============================================================================
+/* Capture of every analysis hop to a memory-mapped ".sgcap" file for QA.
+ *
+ * The audio thread pushes each hop's 8-bit levels and packed gate mask into a
+ * SpectrogramFrameRing, exactly like the spectrogram view does. A writer
+ * thread drains that ring straight into the mapped file. The container is
+ * fixed-stride, so a reader can map it and index frames without copying.
+ *
+ * Layout (little-endian):
+ *
+ *   FileHeader                   64 bytes, see below
+ *   frame 0 .. numFrames - 1     frameBytes each:
+ *       FrameRecordHeader        16 bytes: position, numBins, hopSize
+ *       uint8  levels[maxBins]   padded to a multiple of 4 bytes
+ *       uint32 gateMask[(maxBins + 31) / 32]   bit (bin & 31) of word (bin >> 5) set when open
+ *
+ * Level L means floorDecibels * (1 - L / 255) dBFS, with a full scale sine at 0 dB.
+ * position is the number of analysis-rate input samples before the end of the
+ * frame's window, and hopSize the hop of the configuration that made it, so the
+ * next frame ends at most a hop later. Any further shows frames the ring had to
+ * drop. A frame holds bins DC to Nyquist, so its FFT size is 2 * (numBins - 1).
+ * Both can change part way through a capture with Auto quality.
+ */
+namespace AnalysisCapture
+{
+    struct FileHeader
+    {
+        char magic[8];          // "SGCAPT\0\0"
+        uint32_t version;       // currentVersion
+        uint32_t headerBytes;   // sizeof (FileHeader)
+        uint32_t frameBytes;    // stride of one frame record
+        uint32_t maxBins;       // level slots per record
+        uint32_t fftSize;       // when the capture started, the records have any later ones
+        uint32_t hopSize;       // when the capture started, the records have any later ones
+        double sampleRate;      // analysis rate, i.e. after any decimation
+        float floorDecibels;
+        uint32_t flags;         // reserved, 0
+        uint64_t numFrames;     // updated as frames are appended
+        uint64_t numDropped;    // frames lost because the writer fell behind
+    };
+
+    struct FrameRecordHeader
+    {
+        int64_t position;
+        uint32_t numBins;
+        uint32_t hopSize;       // since version 2
+    };
+
+    static_assert (sizeof (FileHeader) == 64, "the header layout is part of the file format");
+    static_assert (sizeof (FrameRecordHeader) == 16, "the record layout is part of the file format");
+
+    constexpr uint32_t currentVersion = 2;
+    constexpr char magic[8] = { 'S', 'G', 'C', 'A', 'P', 'T', 0, 0 };
+
+    constexpr int getLevelBytes (int maxBins) noexcept { return (maxBins + 3) & ~3; }
+    constexpr int getFrameBytes (int maxBins) noexcept { return static_cast<int> (sizeof (FrameRecordHeader)) + getLevelBytes (maxBins) + 4 * ((maxBins + 31) / 32); }
+
+    inline float levelToDecibels (uint8_t level, float floorDecibels = SpectrogramFrameRing::floorDecibels) noexcept
+    {
+        return floorDecibels * (1.0f - static_cast<float> (level) / 255.0f);
+    }
+
+    struct Format
+    {
+        int fftSize = 1024;
+        int hopSize = 256;
+        double sampleRate = 44100.0;
+    };
+}
+
+//==============================================================================
+/* Drains a ring into a capture file on a background thread.
+ *
+ * The file grows in doubling steps and is remapped each time, so a long
+ * capture costs a handful of remaps. The header's frame count is updated after
+ * every drain, and the file is trimmed to its real length on destruction.
+ */
+class AnalysisCaptureWriter : private juce::Thread
+{
+public:
+    AnalysisCaptureWriter (SpectrogramFrameRing& ringToDrain, const juce::File& file, const AnalysisCapture::Format& format);
+
+    // Stops taking frames, writes what's left and trims the file
+    ~AnalysisCaptureWriter() override;
+
+    // Creates the file and starts pulling frames from the ring. Fails if the file can't be created or mapped.
+    bool start();
+
+    const juce::File& getFile() const noexcept { return file; }
+    int64_t getNumFramesWritten() const noexcept { return numFramesWritten.load (std::memory_order_relaxed); }
+
+private:
+    void run() override;
+    void drain();
+    bool mapWithCapacity (int64_t numFrames);
+    AnalysisCapture::FileHeader& getHeader() noexcept;
+
+    SpectrogramFrameRing& ring;
+    const juce::File file;
+    const AnalysisCapture::Format format;
+    const int maxBins;
+    const int frameBytes;
+
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    int64_t capacityInFrames = 0;
+    int64_t droppedAtStart = 0;
+    std::atomic<int64_t> numFramesWritten { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisCaptureWriter)
+};
+
+//==============================================================================
+/* Read-only, zero-copy view of a capture file. Frames point into the mapping. */
+class AnalysisCaptureReader
+{
+public:
+    explicit AnalysisCaptureReader (const juce::File& file);
+
+    // False if the file is missing, too short, or not a capture this version can read
+    bool isValid() const noexcept { return header != nullptr; }
+
+    const AnalysisCapture::FileHeader& getHeader() const noexcept { return *header; }
+
+    // Frames written when the file was opened (a capture may still be appending)
+    int64_t getNumFrames() const noexcept { return numFrames; }
+
+    SpectrogramFrameRing::Frame getFrame (int64_t index) const noexcept;
+
+private:
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    const AnalysisCapture::FileHeader* header = nullptr;
+    int64_t numFrames = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisCaptureReader)
+};
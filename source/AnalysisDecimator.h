@@ -0,0 +1,204 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <vector>
+
+//==============================================================================
+/* Runs the STFT at a fraction of a high host sample rate.
+ *
+ * Each input sample goes through a linear-phase Kaiser lowpass at the decimated
+ * Nyquist. Every factor-th sample is taken at the low rate, and what the STFT
+ * makes of it is interpolated back up with the same filter in polyphase form, so
+ * both sides cost about 32 multiply-adds per full rate sample at any factor.
+ * Content above the decimated Nyquist (24 kHz when 192 kHz becomes 48 kHz) is
+ * not passed to the wet signal.
+ *
+ * All three filters and every channel's history are allocated up front, so
+ * changing the factor on the audio thread only clears state.
+ */
+class AnalysisDecimator
+{
+public:
+    static constexpr int maxFactor = 8;
+
+    AnalysisDecimator()
+    {
+        for (int factor = 2; factor <= maxFactor; factor *= 2)
+        {
+            // Cutoff at the decimated Nyquist, ~70 dB stopband from 0.58 of the decimated rate
+            auto coefficients = juce::dsp::FilterDesign<float>::designFIRLowpassWindowMethod (
+                0.5f, static_cast<double> (factor), static_cast<size_t> (tapsPerFactor * factor),
+                juce::dsp::WindowingFunction<float>::kaiser, 7.0f);
+
+            auto& design = designs[static_cast<size_t> (factorToIndex (factor))];
+            const auto* raw = coefficients->getRawCoefficients();
+            design.taps.assign (raw, raw + coefficients->getFilterOrder() + 1);
+
+            // Unity DC gain through the lowpass, and factor times that for the zero-stuffed interpolator
+            float sum = 0.0f;
+            for (auto tap : design.taps)
+                sum += tap;
+
+            for (auto& tap : design.taps)
+                tap /= sum;
+
+            // Phase p of the interpolator uses taps p, p + factor, ..., stored newest last to match the history
+            const int numTaps = static_cast<int> (design.taps.size());
+            design.phaseLength = (numTaps + factor - 1) / factor;
+            design.phases.assign (static_cast<size_t> (design.phaseLength * factor), 0.0f);
+
+            for (int phase = 0; phase < factor; ++phase)
+                for (int m = 0; phase + m * factor < numTaps; ++m)
+                    design.phases[static_cast<size_t> (phase * design.phaseLength + design.phaseLength - 1 - m)]
+                        = static_cast<float> (factor) * design.taps[static_cast<size_t> (phase + m * factor)];
+        }
+    }
+
+    // Allocates history for every channel at the longest filter
+    void prepare (int numChannels)
+    {
+        const auto& longest = designs.back();
+        channels.resize (static_cast<size_t> (juce::jmax (1, numChannels)));
+
+        for (auto& channel : channels)
+        {
+            channel.input.assign (2 * longest.taps.size(), 0.0f);
+            channel.lowRate.assign (static_cast<size_t> (2 * longest.phaseLength), 0.0f);
+        }
+
+        reset();
+    }
+
+    int getNumChannels() const noexcept { return static_cast<int> (channels.size()); }
+
+    // factor is 1, 2, 4 or 8. Clears the filter state when it changes.
+    void setFactor (int newFactor) noexcept
+    {
+        jassert (newFactor == 1 || newFactor == 2 || newFactor == 4 || newFactor == 8);
+
+        if (newFactor != factor)
+        {
+            factor = newFactor;
+            reset();
+        }
+    }
+
+    int getFactor() const noexcept { return factor; }
+
+    // Group delay of the lowpass and the interpolator together, at the full rate
+    int getLatencySamples() const noexcept { return factor > 1 ? static_cast<int> (getDesign().taps.size()) - 1 : 0; }
+
+    void reset() noexcept
+    {
+        for (auto& channel : channels)
+        {
+            std::fill (channel.input.begin(), channel.input.end(), 0.0f);
+            std::fill (channel.lowRate.begin(), channel.lowRate.end(), 0.0f);
+            channel.inputPos = 0;
+            channel.lowRatePos = 0;
+        }
+
+        phase = 0;
+    }
+
+    //==============================================================================
+    /* Every channel advances in lockstep, one full rate sample at a time:
+     *
+     *     pushInput() for each channel
+     *     if isLowRateStep(): getLowRateSample() and pushLowRateOutput() for each channel
+     *     interpolate() for each channel
+     *     advance()
+     *
+     * Only meaningful while the factor is above 1.
+     */
+    bool isLowRateStep() const noexcept { return phase == 0; }
+
+    void pushInput (int channelIndex, float input) noexcept
+    {
+        auto& channel = channels[static_cast<size_t> (channelIndex)];
+        const int numTaps = static_cast<int> (getDesign().taps.size());
+
+        // Histories are written twice so the newest numTaps values are always contiguous
+        channel.input[static_cast<size_t> (channel.inputPos)] = input;
+        channel.input[static_cast<size_t> (channel.inputPos + numTaps)] = input;
+        channel.inputPos = (channel.inputPos + 1) % numTaps;
+    }
+
+    float getLowRateSample (int channelIndex) const noexcept
+    {
+        const auto& design = getDesign();
+        const auto& channel = channels[static_cast<size_t> (channelIndex)];
+        const int numTaps = static_cast<int> (design.taps.size());
+
+        // Symmetric taps, so the oldest-first history needs no reversal
+        const float* history = channel.input.data() + channel.inputPos;
+        float low = 0.0f;
+        for (int i = 0; i < numTaps; ++i)
+            low += design.taps[static_cast<size_t> (i)] * history[i];
+
+        return low;
+    }
+
+    void pushLowRateOutput (int channelIndex, float output) noexcept
+    {
+        auto& channel = channels[static_cast<size_t> (channelIndex)];
+        const int phaseLength = getDesign().phaseLength;
+
+        channel.lowRate[static_cast<size_t> (channel.lowRatePos)] = output;
+        channel.lowRate[static_cast<size_t> (channel.lowRatePos + phaseLength)] = output;
+        channel.lowRatePos = (channel.lowRatePos + 1) % phaseLength;
+    }
+
+    float interpolate (int channelIndex) const noexcept
+    {
+        const auto& design = getDesign();
+        const auto& channel = channels[static_cast<size_t> (channelIndex)];
+
+        const float* history = channel.lowRate.data() + channel.lowRatePos;
+        const float* phaseTaps = design.phases.data() + phase * design.phaseLength;
+        float output = 0.0f;
+        for (int i = 0; i < design.phaseLength; ++i)
+            output += phaseTaps[i] * history[i];
+
+        return output;
+    }
+
+    void advance() noexcept { phase = (phase + 1) % factor; }
+
+    // Largest power of two factor (up to maxFactor) that keeps the analysis rate at or above minAnalysisRate
+    static int factorForSampleRate (double sampleRate, double minAnalysisRate = 44100.0) noexcept
+    {
+        int result = 1;
+        while (result < maxFactor && sampleRate / (2 * result) >= minAnalysisRate)
+            result *= 2;
+
+        return result;
+    }
+
+private:
+    static constexpr int tapsPerFactor = 32;
+
+    struct Design
+    {
+        std::vector<float> taps;
+        std::vector<float> phases;
+        int phaseLength = 0;
+    };
+
+    struct ChannelState
+    {
+        std::vector<float> input;
+        std::vector<float> lowRate;
+        int inputPos = 0;
+        int lowRatePos = 0;
+    };
+
+    static int factorToIndex (int f) noexcept { return f == 2 ? 0 : (f == 4 ? 1 : 2); }
+    const Design& getDesign() const noexcept { return designs[static_cast<size_t> (factorToIndex (factor))]; }
+
+    std::array<Design, 3> designs;
+    std::vector<ChannelState> channels;
+    int factor = 1;
+    int phase = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SpectralKernels.h"
+#include <vector>
+
+//==============================================================================
+/* One mask's per-bin state across hops, kept as structure-of-arrays so each
+ * state kernel in SpectralKernels.h streams through only the parts it needs:
+ *
+ *   openBits      whether each bin is open, one bit per bin, for the hysteresis
+ *   gains         the smoothed gain each bin had after the last hop
+ *   holdCounters  hops left before a falling gain may release
+ *
+ * Allocated once for the largest FFT. Until it is primed by a first hop, the
+ * gains are taken as they come, so a reset neither fades in nor out.
+ *
+ * With a frequency band only the bins in it are updated. The others pass at
+ * unity, so they are kept closed at a gain of 1, which is where they start
+ * from again when the band moves to take them in.
+ */
+struct BinGateState
+{
+    void allocate (int maxNumBins)
+    {
+        openBits.assign (static_cast<size_t> (SpectralKernels::getNumStateWords (maxNumBins)), 0u);
+        gains.assign (static_cast<size_t> (maxNumBins), 1.0f);
+        holdCounters.assign (static_cast<size_t> (maxNumBins), 0);
+        primed = false;
+        bandStart = 0;
+        bandEnd = maxNumBins;
+    }
+
+    // Forget every bin, for a new stream or a new FFT size
+    void reset() noexcept
+    {
+        std::fill (openBits.begin(), openBits.end(), 0u);
+        std::fill (gains.begin(), gains.end(), 1.0f);
+        std::fill (holdCounters.begin(), holdCounters.end(), 0);
+        primed = false;
+        bandStart = 0;
+        bandEnd = static_cast<int> (gains.size());
+    }
+
+    // Bins [start, end) are the ones being updated. Any others go back to passing at unity.
+    void setBand (int start, int end) noexcept
+    {
+        if (start == bandStart && end == bandEnd)
+            return;
+
+        for (int bin = 0; bin < static_cast<int> (gains.size()); ++bin)
+        {
+            if (bin >= start && bin < end)
+                continue;
+
+            openBits[static_cast<size_t> (bin / SpectralKernels::binsPerWord)] &= ~(1u << (bin % SpectralKernels::binsPerWord));
+            gains[static_cast<size_t> (bin)] = 1.0f;
+            holdCounters[static_cast<size_t> (bin)] = 0;
+        }
+
+        bandStart = start;
+        bandEnd = end;
+    }
+
+    std::vector<uint32_t> openBits;
+    std::vector<float> gains;
+    std::vector<int32_t> holdCounters;
+    bool primed = false;
+    int bandStart = 0;
+    int bandEnd = 0;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+//==============================================================================
+/* Branch-free log2/exp2 approximations for per-bin gain computation.
+ *
+ * Both work on the float bit pattern plus a short polynomial, with no calls or
+ * lookups. The array versions are plain loops that compilers auto-vectorise.
+ *
+ * log2: the mantissa is reduced to [sqrt(1/2), sqrt(2)) and log2 is evaluated as
+ *       2/ln(2) * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172, up to t^7.
+ *       The truncated series is good to 1e-7, so the absolute error (< 4e-6 over
+ *       the whole normal range) is float rounding of the result. Positive normal inputs only.
+ * exp2: the fraction is centred on [-0.5, 0.5) and 2^f is a degree 6 Taylor
+ *       expansion of exp(f * ln 2), scaled by sqrt(2). Input is clamped to
+ *       [-126, 126]. Relative error is < 3e-7 (< 3e-6 with fast-math reassociation).
+ *
+ * tests/FastMath.cpp checks both bounds with some headroom.
+ *
+ * Everything sits in an inline namespace named by SPECTRAL_GATE_KERNEL_ISA, so
+ * the copies built with AVX2 or AVX-512 flags (see KernelDispatch.h) never
+ * stand in for the portable ones at link time. That only holds for code defined
+ * in the namespace, so the bit casts are done here with memcpy rather than
+ * through std::bit_cast, whose instantiations are shared by every copy.
+ */
+#ifndef SPECTRAL_GATE_KERNEL_ISA
+ #define SPECTRAL_GATE_KERNEL_ISA portable
+#endif
+
+namespace FastMath
+{
+inline namespace SPECTRAL_GATE_KERNEL_ISA
+{
+    inline uint32_t toBits (float x) noexcept
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+        return bits;
+    }
+
+    inline float fromBits (uint32_t bits) noexcept
+    {
+        float x;
+        std::memcpy (&x, &bits, sizeof (x));
+        return x;
+    }
+
+    inline float log2 (float x) noexcept
+    {
+        const auto bits = toBits (x);
+        auto exponent = static_cast<float> (static_cast<int32_t> (bits >> 23) - 127);
+        auto m = fromBits ((bits & 0x007fffffu) | 0x3f800000u);
+
+        // Centre the mantissa on 1 so the series converges quickly
+        const bool reduce = m > 1.41421356f;
+        m = reduce ? m * 0.5f : m;
+        exponent += reduce ? 1.0f : 0.0f;
+
+        const float t = (m - 1.0f) / (m + 1.0f);
+        const float t2 = t * t;
+        const float series = t * (2.88539008f + t2 * (0.961796694f + t2 * (0.577078016f + t2 * 0.412198583f)));
+        return exponent + series;
+    }
+
+    inline float exp2 (float x) noexcept
+    {
+        x = x < -126.0f ? -126.0f : (x > 126.0f ? 126.0f : x);
+
+        // floor without a libm call: truncate, then step down for negative fractions
+        auto whole = static_cast<int32_t> (x);
+        whole -= (x < static_cast<float> (whole)) ? 1 : 0;
+
+        const float y = (x - static_cast<float> (whole) - 0.5f) * 0.693147181f;
+        const float expY = 1.0f + y * (1.0f + y * (0.5f + y * (0.166666667f + y * (0.0416666667f + y * (0.00833333333f + y * 0.00138888889f)))));
+        const float scale = fromBits (static_cast<uint32_t> (whole + 127) << 23);
+        return expY * 1.41421356f * scale;
+    }
+
+    inline void log2 (const float* input, float* output, int numValues) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            output[i] = log2 (input[i]);
+    }
+
+    inline void exp2 (const float* input, float* output, int numValues) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            output[i] = exp2 (input[i]);
+    }
+}
+}
@@ -0,0 +1,110 @@
+#include "FrameWorker.h"
+
+FrameWorker::FrameWorker (std::function<void()> processFrameToRun)
+    : juce::Thread ("STFT frame worker"),
+      processFrame (std::move (processFrameToRun))
+{
+}
+
+FrameWorker::~FrameWorker()
+{
+    stop();
+}
+
+void FrameWorker::start()
+{
+    if (isThreadRunning())
+        return;
+
+    // Hosts or sandboxes may refuse realtime scheduling, in which case a high priority thread still beats the fallback
+    if (! startRealtimeThread (juce::Thread::RealtimeOptions {}))
+        startThread (juce::Thread::Priority::highest);
+}
+
+void FrameWorker::stop()
+{
+    signalThreadShouldExit();
+    wakeUp.release();
+    stopThread (1000);
+}
+
+//==============================================================================
+void FrameWorker::submit() noexcept
+{
+    jassert (state.load() == idle);
+    state.store (queued, std::memory_order_release);
+    wakeUp.release();
+}
+
+FrameWorker::Collected FrameWorker::collect (int64_t maxWaitTicks) noexcept
+{
+    int expected = queued;
+
+    // Not started yet: take it back and run it here
+    if (state.compare_exchange_strong (expected, running, std::memory_order_acq_rel))
+    {
+        processFrame();
+        state.store (idle, std::memory_order_release);
+        numLateFrames.fetch_add (1, std::memory_order_relaxed);
+        return Collected::late;
+    }
+
+    if (expected == idle || expected == done)
+    {
+        state.store (idle, std::memory_order_release);
+        return Collected::onTime;
+    }
+
+    // Part way through on the worker, which is normally at most one frame's work away
+    numLateFrames.fetch_add (1, std::memory_order_relaxed);
+
+    if (! waitWhileRunning (maxWaitTicks))
+    {
+        numMissedFrames.fetch_add (1, std::memory_order_relaxed);
+        return Collected::missed;
+    }
+
+    state.store (idle, std::memory_order_release);
+    return Collected::late;
+}
+
+bool FrameWorker::cancel (int64_t maxWaitTicks) noexcept
+{
+    int expected = queued;
+    if (state.compare_exchange_strong (expected, idle, std::memory_order_acq_rel))
+        return true;
+
+    if (! waitWhileRunning (maxWaitTicks))
+        return false;
+
+    state.store (idle, std::memory_order_release);
+    return true;
+}
+
+bool FrameWorker::waitWhileRunning (int64_t maxWaitTicks) const noexcept
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    while (state.load (std::memory_order_acquire) == running)
+        if (juce::Time::getHighResolutionTicks() - start > maxWaitTicks)
+            return false;
+
+    return true;
+}
+
+//==============================================================================
+void FrameWorker::run()
+{
+    while (! threadShouldExit())
+    {
+        // Woken by submit() and stop(). Frames collect() took back leave spare wake-ups, which find nothing queued.
+        wakeUp.acquire();
+
+        int expected = queued;
+        if (state.compare_exchange_strong (expected, running, std::memory_order_acq_rel))
+        {
+            processFrame();
+            state.store (done, std::memory_order_release);
+        }
+    }
+}
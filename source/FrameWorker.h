@@ -0,0 +1,75 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <functional>
+#include <semaphore>
+
+//==============================================================================
+/* Runs one STFT frame at a time on a pre-spawned realtime thread.
+ *
+ * The audio thread submit()s a frame and collect()s it one hop later. The
+ * handover is a single-slot lock-free mailbox: an atomic state plus a
+ * semaphore whose release() never blocks. Only one frame is ever in flight, so
+ * whoever runs processFrame owns the frame buffers until the state moves on.
+ *
+ * If the worker hasn't started a frame by the time collect() wants it, the
+ * audio thread claims it and runs it synchronously. If the worker is part way
+ * through, the audio thread spins for at most the time it's given, as a worker
+ * that has been preempted could otherwise hold it up for any length of time.
+ * A frame that still isn't finished is a miss and stays pending, and whoever
+ * owns the frame buffers has to work around it. Both count as late frames.
+ */
+class FrameWorker : private juce::Thread
+{
+public:
+    explicit FrameWorker (std::function<void()> processFrame);
+    ~FrameWorker() override;
+
+    // Message thread. Frames submitted while the worker isn't running are run by collect().
+    void start();
+    void stop();
+    bool isRunning() const { return isThreadRunning(); }
+
+    // Audio thread. Only one frame may be pending, so collect() before the next submit().
+    void submit() noexcept;
+    bool isPending() const noexcept { return state.load (std::memory_order_acquire) != idle; }
+
+    enum class Collected
+    {
+        onTime,     // the worker had finished it
+        late,       // run by the caller, or finished by the worker while the caller waited
+        missed      // the worker is still part way through it, so it's still pending
+    };
+
+    // Makes sure the pending frame has been processed, spinning for at most maxWaitTicks
+    // (see juce::Time::getHighResolutionTicks) while the worker finishes it
+    Collected collect (int64_t maxWaitTicks) noexcept;
+
+    // Drops the pending frame. Returns false, leaving it pending, if the worker is part
+    // way through it and doesn't finish within maxWaitTicks.
+    bool cancel (int64_t maxWaitTicks) noexcept;
+
+    int64_t getNumLateFrames() const noexcept { return numLateFrames.load (std::memory_order_relaxed); }
+    int64_t getNumMissedFrames() const noexcept { return numMissedFrames.load (std::memory_order_relaxed); }
+
+private:
+    enum State
+    {
+        idle,
+        queued,
+        running,
+        done
+    };
+
+    void run() override;
+    bool waitWhileRunning (int64_t maxWaitTicks) const noexcept;
+
+    const std::function<void()> processFrame;
+    std::atomic<int> state { idle };
+    std::counting_semaphore<> wakeUp { 0 };
+    std::atomic<int64_t> numLateFrames { 0 };
+    std::atomic<int64_t> numMissedFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrameWorker)
+};
@@ -0,0 +1,58 @@
+#include "KernelDispatch.h"
+#include <juce_core/juce_core.h>
+#include <array>
+
+namespace
+{
+    struct SupportedKernels
+    {
+        std::array<const SpectralKernels::KernelTable*, 4> tables {};
+        size_t size = 0;
+
+        void add (const SpectralKernels::KernelTable& table) noexcept { tables[size++] = &table; }
+    };
+
+    SupportedKernels findSupportedKernels() noexcept
+    {
+        SupportedKernels supported;
+        supported.add (SpectralKernels::scalarKernels);
+
+       #if SPECTRAL_GATE_KERNELS_X86
+        if (juce::SystemStats::hasSSE2())
+            supported.add (SpectralKernels::sse2Kernels);
+
+        // The AVX2 build also lets the compiler fuse multiply-adds
+        if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+            supported.add (SpectralKernels::avx2Kernels);
+
+        if (juce::SystemStats::hasAVX512F())
+            supported.add (SpectralKernels::avx512Kernels);
+       #endif
+
+       #if SPECTRAL_GATE_KERNELS_NEON
+        if (juce::SystemStats::hasNeon())
+            supported.add (SpectralKernels::neonKernels);
+       #endif
+
+        return supported;
+    }
+
+    // Detected on first use, which is the first processor's construction
+    const SupportedKernels& getSupportedKernelsOnce() noexcept
+    {
+        static const SupportedKernels supported = findSupportedKernels();
+        return supported;
+    }
+}
+
+std::span<const SpectralKernels::KernelTable* const> SpectralKernels::getSupportedKernels() noexcept
+{
+    const auto& supported = getSupportedKernelsOnce();
+    return { supported.tables.data(), supported.size };
+}
+
+const SpectralKernels::KernelTable& SpectralKernels::getKernels() noexcept
+{
+    const auto& supported = getSupportedKernelsOnce();
+    return *supported.tables[supported.size - 1];
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "SpectralKernels.h"
+#include <span>
+
+//==============================================================================
+/* Runtime selection between copies of SpectralKernels built for different
+ * instruction sets.
+ *
+ * Each file in source/kernels/ defines SPECTRAL_GATE_KERNEL_ISA, includes
+ * SpectralKernels.h and is compiled with that ISA's flags (see the top-level
+ * CMakeLists.txt), then exports its kernels as a KernelTable. The inline
+ * namespace keeps every copy of the kernels distinct. Templates from outside
+ * it, like std::max, would be instantiated once for all copies and the linker
+ * could keep an AVX build of them, so the kernels don't use any.
+ *
+ * The table is chosen once, when the first processor is constructed, from the
+ * CPU features JUCE reads with CPUID (or the NEON flag on ARM), so the audio
+ * thread only ever calls through a pointer.
+ */
+#if defined (__x86_64__) || defined (_M_X64) || defined (__i386__) || defined (_M_IX86)
+ #define SPECTRAL_GATE_KERNELS_X86 1
+#else
+ #define SPECTRAL_GATE_KERNELS_X86 0
+#endif
+
+#if defined (__aarch64__) || defined (_M_ARM64) || defined (__ARM_NEON)
+ #define SPECTRAL_GATE_KERNELS_NEON 1
+#else
+ #define SPECTRAL_GATE_KERNELS_NEON 0
+#endif
+
+namespace SpectralKernels
+{
+    struct KernelTable
+    {
+        const char* name;
+        void (*applyWindow) (float* frame, const float* window, int numSamples) noexcept;
+        void (*computePower) (const float* real, const float* imag, float* power, int numBins) noexcept;
+        void (*gateGains) (const float* power, float* gains, int numBins, float thresholdPower, float belowGain) noexcept;
+        void (*expanderGains) (const float* power, float* gains, int numBins, const ExpanderCurve& curve) noexcept;
+        void (*hysteresisDetection) (const float* power, float* detection, const uint32_t* openBits, int numBins, float openBoost) noexcept;
+        void (*updateOpenBits) (const float* detection, uint32_t* openBits, int numBins, float thresholdPower) noexcept;
+        void (*smoothGains) (float* gains, float* smoothed, int32_t* holdCounters, int numBins, const GainSmoothing& smoothing) noexcept;
+        void (*applyGains) (float* real, float* imag, const float* gains, int numBins) noexcept;
+        void (*overlapAdd) (float* accumulator, const float* frame, float gain, int numSamples) noexcept;
+        void (*mixDryWet) (float* wet, const float* dry, float wetGain, int numSamples) noexcept;
+    };
+
+    // Every variant in this build, whether or not this CPU can run it
+    extern const KernelTable scalarKernels;
+
+   #if SPECTRAL_GATE_KERNELS_X86
+    extern const KernelTable sse2Kernels;
+    extern const KernelTable avx2Kernels;
+    extern const KernelTable avx512Kernels;
+   #endif
+
+   #if SPECTRAL_GATE_KERNELS_NEON
+    extern const KernelTable neonKernels;
+   #endif
+
+    // The variants this CPU can run, slowest first. Scalar is always there, as the reference.
+    std::span<const KernelTable* const> getSupportedKernels() noexcept;
+
+    // The last of getSupportedKernels(), the fastest this CPU runs
+    const KernelTable& getKernels() noexcept;
+}
+
+// Builds a KernelTable from the SpectralKernels copy compiled into the current file
+#define SPECTRAL_GATE_KERNEL_TABLE(displayName)  \
+    SpectralKernels::KernelTable                 \
+    {                                            \
+        displayName,                             \
+        SpectralKernels::applyWindow,            \
+        SpectralKernels::computePower,           \
+        SpectralKernels::gateGains,              \
+        SpectralKernels::expanderGains,          \
+        SpectralKernels::hysteresisDetection,    \
+        SpectralKernels::updateOpenBits,         \
+        SpectralKernels::smoothGains,            \
+        SpectralKernels::applyGains,             \
+        SpectralKernels::overlapAdd,             \
+        SpectralKernels::mixDryWet               \
+    }
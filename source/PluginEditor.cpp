@@ -1,58 +1,61 @@
 #include "PluginEditor.h"
 
 PluginEditor::PluginEditor (PluginProcessor& p)
-    : AudioProcessorEditor (&p), processorRef (p), spectrumAnalyzer(p)
+    : AudioProcessorEditor (&p), processorRef (p), spectrumAnalyzer(p), spectrogramView(p)
 {
     // Setup spectrum analyzer
     addAndMakeVisible(spectrumAnalyzer);
-    
-    // Setup cutoff slider
-    cutoffSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-    cutoffSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 80, 20);
-    addAndMakeVisible(cutoffSlider);
-    cutoffAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
-        processorRef.getParameters(), "cutoff", cutoffSlider);
-    
-    cutoffLabel.setText("Cutoff Amplitude", juce::dontSendNotification);
-    cutoffLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible(cutoffLabel);
-    
-    // Setup balance slider
-    balanceSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-    balanceSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 80, 20);
-    addAndMakeVisible(balanceSlider);
-    balanceAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
-        processorRef.getParameters(), "balance", balanceSlider);
-    
-    balanceLabel.setText("Weak/Strong Balance", juce::dontSendNotification);
-    balanceLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible(balanceLabel);
-    
-    // Setup dry/wet slider
-    dryWetSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-    dryWetSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 80, 20);
-    addAndMakeVisible(dryWetSlider);
-    dryWetAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
-        processorRef.getParameters(), "drywet", dryWetSlider);
-    
-    dryWetLabel.setText("Dry/Wet", juce::dontSendNotification);
-    dryWetLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible(dryWetLabel);
-    
-    // Setup FFT size combo box
-    fftSizeComboBox.addItem("64", 1);
-    fftSizeComboBox.addItem("128", 2);
-    fftSizeComboBox.addItem("256", 3);
-    fftSizeComboBox.addItem("512", 4);
-    fftSizeComboBox.addItem("1024", 5);
-    fftSizeComboBox.addItem("2048", 6);
-    addAndMakeVisible(fftSizeComboBox);
-    fftSizeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
-        processorRef.getParameters(), "fftsize", fftSizeComboBox);
-    
-    fftSizeLabel.setText("FFT Size", juce::dontSendNotification);
-    fftSizeLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible(fftSizeLabel);
+    addAndMakeVisible(spectrogramView);
+    
+    // Setup knobs
+    setupKnob(cutoffKnob, "cutoff", "Cutoff Amplitude");
+    setupKnob(balanceKnob, "balance", "Weak/Strong Balance");
+    setupKnob(ratioKnob, "ratio", "Ratio");
+    setupKnob(kneeKnob, "knee", "Knee");
+    setupKnob(rangeKnob, "range", "Range");
+    setupKnob(windowTimeKnob, "windowtime", "Window Time");
+    setupKnob(hysteresisKnob, "hysteresis", "Hysteresis");
+    setupKnob(attackKnob, "attack", "Attack");
+    setupKnob(holdKnob, "hold", "Hold");
+    setupKnob(releaseKnob, "release", "Release");
+    setupKnob(lowFreqKnob, "lowfreq", "Low Limit");
+    setupKnob(highFreqKnob, "highfreq", "High Limit");
+    setupKnob(cpuBudgetKnob, "cpubudget", "CPU Budget");
+    setupKnob(dryWetKnob, "drywet", "Dry/Wet");
+    
+    // Setup choices
+    setupChoice(modeChoice, "mode", "Mode");
+    setupChoice(resolutionChoice, "resolution", "Resolution");
+    setupChoice(fftSizeChoice, "fftsize", "FFT Size");
+    setupChoice(analysisRateChoice, "analysisrate", "Analysis Rate");
+    setupChoice(detectorChoice, "detector", "Detector");
+    setupChoice(fftThreadChoice, "fftthread", "FFT Thread");
+    setupChoice(qualityChoice, "quality", "Quality");
+    
+    // Group the controls, left to right within each group
+    setupGroup(gateGroup, "Gate", { &cutoffKnob, &balanceKnob, &hysteresisKnob, &dryWetKnob }, { &modeChoice });
+    setupGroup(dynamicsGroup, "Dynamics", { &ratioKnob, &kneeKnob, &rangeKnob, &attackKnob, &holdKnob, &releaseKnob }, {});
+    setupGroup(analysisGroup, "Analysis", { &windowTimeKnob, &lowFreqKnob, &highFreqKnob },
+               { &resolutionChoice, &fftSizeChoice, &analysisRateChoice, &detectorChoice });
+    setupGroup(engineGroup, "Engine", { &cpuBudgetKnob }, { &qualityChoice, &fftThreadChoice });
+    
+    // Capture of every hop for QA, written next to the user's documents
+    addAndMakeVisible(captureButton);
+    captureButton.setButtonText(processorRef.isCapturing() ? "Stop capture" : "Start capture");
+    captureButton.onClick = [this] {
+        if (processorRef.isCapturing())
+        {
+            processorRef.stopCapture();
+        }
+        else
+        {
+            auto folder = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("Spectral Gate Captures");
+            folder.createDirectory();
+            processorRef.startCapture(folder.getNonexistentChildFile("capture", ".sgcap"));
+        }
+        
+        captureButton.setButtonText(processorRef.isCapturing() ? "Stop capture" : "Start capture");
+    };
     
     // Setup inspect button
     addAndMakeVisible (inspectButton);
@@ -68,13 +71,93 @@ PluginEditor::PluginEditor (PluginProcessor& p)
         inspector->setVisible (true);
     };
 
-    setSize (800, 500);
+    // Resizable from the default size up, the controls spread out and the displays grow
+    setResizable(true, true);
+    setResizeLimits(defaultWidth, defaultHeight, 2 * defaultWidth, 2 * defaultHeight);
+    setSize (defaultWidth, defaultHeight);
 }
 
 PluginEditor::~PluginEditor()
 {
 }
 
+void PluginEditor::setupKnob(ParameterKnob& knob, const juce::String& parameterID, const juce::String& labelText)
+{
+    knob.slider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+    knob.slider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 80, 20);
+    addAndMakeVisible(knob.slider);
+    knob.attachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.getParameters(), parameterID, knob.slider);
+    
+    knob.label.setText(labelText, juce::dontSendNotification);
+    knob.label.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(knob.label);
+}
+
+void PluginEditor::setupChoice(ParameterChoice& choice, const juce::String& parameterID, const juce::String& labelText)
+{
+    // Items come from the parameter so the list can't drift from the processor
+    if (auto* parameter = dynamic_cast<juce::AudioParameterChoice*>(processorRef.getParameters().getParameter(parameterID)))
+        choice.comboBox.addItemList(parameter->choices, 1);
+    
+    addAndMakeVisible(choice.comboBox);
+    choice.attachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.getParameters(), parameterID, choice.comboBox);
+    
+    choice.label.setText(labelText, juce::dontSendNotification);
+    choice.label.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(choice.label);
+}
+
+void PluginEditor::setupGroup(ControlGroup& group, const juce::String& title, std::vector<ParameterKnob*> knobs, std::vector<ParameterChoice*> choices)
+{
+    group.frame.setText(title);
+    group.frame.setColour(juce::GroupComponent::outlineColourId, juce::Colour(0xff606060));
+    addAndMakeVisible(group.frame);
+    group.frame.toBack();
+    
+    group.knobs = std::move(knobs);
+    group.choices = std::move(choices);
+}
+
+void PluginEditor::layOutRow(std::initializer_list<ControlGroup*> groups, juce::Rectangle<int> area)
+{
+    // The groups share the row in proportion to how many controls they hold
+    int numColumns = 0;
+    for (auto* group : groups)
+        numColumns += group->getNumColumns();
+    
+    const int spacing = 10;
+    const int groupsWidth = area.getWidth() - spacing * (static_cast<int>(groups.size()) - 1);
+    
+    for (auto* group : groups)
+    {
+        auto groupArea = area.removeFromLeft(groupsWidth * group->getNumColumns() / numColumns);
+        area.removeFromLeft(spacing);
+        group->frame.setBounds(groupArea);
+        
+        // Clear of the outline and the title along its top edge
+        auto inner = groupArea.reduced(8);
+        inner.removeFromTop(12);
+        const int columnWidth = inner.getWidth() / group->getNumColumns();
+        
+        for (auto* knob : group->knobs)
+        {
+            auto knobArea = inner.removeFromLeft(columnWidth).reduced(2, 0);
+            knob->label.setBounds(knobArea.removeFromTop(20));
+            knob->slider.setBounds(knobArea);
+        }
+        
+        for (auto* choice : group->choices)
+        {
+            auto choiceArea = inner.removeFromLeft(columnWidth).reduced(5, 0);
+            choiceArea = choiceArea.withSizeKeepingCentre(choiceArea.getWidth(), 44);
+            choice->label.setBounds(choiceArea.removeFromTop(20));
+            choice->comboBox.setBounds(choiceArea);
+        }
+    }
+}
+
 void PluginEditor::paint (juce::Graphics& g)
 {
     // Fill background
@@ -93,35 +176,18 @@ void PluginEditor::resized()
     // Title area
     area.removeFromTop(60);
     
-    // Spectrum analyzer at the top
-    spectrumAnalyzer.setBounds(area.removeFromTop(180).reduced(20, 10));
-    
-    // Controls area
-    auto controlsArea = area.reduced(20);
-    
-    // Three columns for the three knobs
-    const int knobWidth = controlsArea.getWidth() / 3;
-    
-    // Cutoff column
-    auto cutoffArea = controlsArea.removeFromLeft(knobWidth).reduced(10);
-    cutoffLabel.setBounds(cutoffArea.removeFromTop(30));
-    cutoffSlider.setBounds(cutoffArea.removeFromTop(120));
-    
-    // Balance column
-    auto balanceArea = controlsArea.removeFromLeft(knobWidth).reduced(10);
-    balanceLabel.setBounds(balanceArea.removeFromTop(30));
-    balanceSlider.setBounds(balanceArea.removeFromTop(120));
-    
-    // Dry/Wet column
-    auto dryWetArea = controlsArea.reduced(10);
-    dryWetLabel.setBounds(dryWetArea.removeFromTop(30));
-    dryWetSlider.setBounds(dryWetArea.removeFromTop(120));
+    // Capture button at bottom left, inspect button at bottom right
+    auto buttonsArea = area.removeFromBottom(60);
+    captureButton.setBounds(buttonsArea.removeFromLeft(140).withSizeKeepingCentre(120, 40));
+    inspectButton.setBounds(buttonsArea.removeFromRight(140).withSizeKeepingCentre(120, 40));
     
-    // FFT size control at bottom center
-    auto fftSizeArea = area.removeFromBottom(60).withSizeKeepingCentre(200, 50);
-    fftSizeLabel.setBounds(fftSizeArea.removeFromTop(20));
-    fftSizeComboBox.setBounds(fftSizeArea);
+    // Two rows of grouped controls above the buttons
+    auto controlsArea = area.removeFromBottom(2 * groupHeight + 10).reduced(20, 0);
+    layOutRow({ &gateGroup, &dynamicsGroup }, controlsArea.removeFromTop(groupHeight));
+    controlsArea.removeFromTop(10);
+    layOutRow({ &analysisGroup, &engineGroup }, controlsArea);
     
-    // Inspect button at bottom
-    inspectButton.setBounds(getLocalBounds().removeFromBottom(60).removeFromRight(140).withSizeKeepingCentre(120, 40));
+    // The spectrum analyzer and the spectrogram history underneath share what's left
+    spectrumAnalyzer.setBounds(area.removeFromTop(area.getHeight() * 9 / 16).reduced(20, 10));
+    spectrogramView.setBounds(area.reduced(20, 10));
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "PluginProcessor.h"
+#include "SpectrogramView.h"
 #include "BinaryData.h"
 #include "melatonin_inspector/melatonin_inspector.h"
 
@@ -40,8 +41,8 @@ public:
         // Draw spectrum
         juce::Path spectrumPath;
         const int numBins = static_cast<int>(magnitudes.size());
-        const int displayBins = numBins / 2; // Only show first half (up to Nyquist)
-        const float binWidth = width / static_cast<float>(displayBins);
+        const int displayBins = numBins; // Frames are already N/2 + 1 bins, DC up to Nyquist
+        const float binWidth = width / static_cast<float>(juce::jmax(1, displayBins - 1));
         
         bool pathStarted = false;
         for (int i = 1; i < displayBins; ++i)
@@ -88,6 +89,14 @@ public:
             }
         }
         
+        // Shade the bins outside the Low/High Limits, which pass untouched
+        const auto activeBins = processorRef.getActiveBins(numBins);
+        const float bandStart = juce::jmin(width, activeBins.getStart() * binWidth);
+        const float bandEnd = juce::jmin(width, activeBins.getEnd() * binWidth);
+        g.setColour(juce::Colour(0xff000000).withAlpha(0.5f));
+        g.fillRect(0.0f, 0.0f, bandStart, height);
+        g.fillRect(bandEnd, 0.0f, width - bandEnd, height);
+        
         // Draw border
         g.setColour(juce::Colour(0xff606060));
         g.drawRect(bounds, 2.0f);
@@ -120,31 +129,80 @@ public:
     void resized() override;
 
 private:
+    // Also the minimum size
+    static constexpr int defaultWidth = 980;
+    static constexpr int defaultHeight = 740;
+    static constexpr int groupHeight = 140;
+    
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     PluginProcessor& processorRef;
     std::unique_ptr<melatonin::Inspector> inspector;
     juce::TextButton inspectButton { "Inspect the UI" };
+    juce::TextButton captureButton { "Start capture" };
     
     // Spectrum analyzer
     SpectrumAnalyzer spectrumAnalyzer;
+    SpectrogramView spectrogramView;
     
     // Parameter controls
-    juce::Slider cutoffSlider;
-    juce::Label cutoffLabel;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> cutoffAttachment;
+    struct ParameterKnob
+    {
+        juce::Slider slider;
+        juce::Label label;
+        std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> attachment;
+    };
+    
+    struct ParameterChoice
+    {
+        juce::ComboBox comboBox;
+        juce::Label label;
+        std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> attachment;
+    };
+    
+    // A titled box of related controls, knobs first then choices, one column each
+    struct ControlGroup
+    {
+        juce::GroupComponent frame;
+        std::vector<ParameterKnob*> knobs;
+        std::vector<ParameterChoice*> choices;
+        
+        int getNumColumns() const { return static_cast<int>(knobs.size() + choices.size()); }
+    };
+    
+    void setupKnob(ParameterKnob& knob, const juce::String& parameterID, const juce::String& labelText);
+    void setupChoice(ParameterChoice& choice, const juce::String& parameterID, const juce::String& labelText);
+    void setupGroup(ControlGroup& group, const juce::String& title, std::vector<ParameterKnob*> knobs, std::vector<ParameterChoice*> choices);
+    void layOutRow(std::initializer_list<ControlGroup*> groups, juce::Rectangle<int> area);
     
-    juce::Slider balanceSlider;
-    juce::Label balanceLabel;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> balanceAttachment;
+    ParameterKnob cutoffKnob;
+    ParameterKnob balanceKnob;
+    ParameterKnob ratioKnob;
+    ParameterKnob kneeKnob;
+    ParameterKnob rangeKnob;
+    ParameterKnob hysteresisKnob;
+    ParameterKnob attackKnob;
+    ParameterKnob holdKnob;
+    ParameterKnob releaseKnob;
+    ParameterKnob lowFreqKnob;
+    ParameterKnob highFreqKnob;
+    ParameterKnob windowTimeKnob;
+    ParameterKnob cpuBudgetKnob;
+    ParameterKnob dryWetKnob;
     
-    juce::Slider dryWetSlider;
-    juce::Label dryWetLabel;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> dryWetAttachment;
+    ParameterChoice modeChoice;
+    ParameterChoice resolutionChoice;
+    ParameterChoice fftSizeChoice;
+    ParameterChoice analysisRateChoice;
+    ParameterChoice detectorChoice;
+    ParameterChoice fftThreadChoice;
+    ParameterChoice qualityChoice;
     
-    juce::ComboBox fftSizeComboBox;
-    juce::Label fftSizeLabel;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> fftSizeAttachment;
+    // Gate and dynamics on the first row, analysis and engine on the second
+    ControlGroup gateGroup;
+    ControlGroup dynamicsGroup;
+    ControlGroup analysisGroup;
+    ControlGroup engineGroup;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginEditor)
 };
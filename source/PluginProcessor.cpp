@@ -36,6 +36,113 @@ juce::AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParam
         [](float value, int) { return juce::String(static_cast<int>(value * 100.0f)) + "%"; }
     ));
 
+    // Gate mode: hard per-bin gate, or soft-knee downward expander using ratio/knee/range
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "mode",
+        "Mode",
+        juce::StringArray{"Gate", "Expander"},
+        0
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "ratio",
+        "Expander Ratio",
+        juce::NormalisableRange<float>(1.0f, 20.0f, 0.1f, 0.5f),
+        4.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return "1:" + juce::String(value, 1); }
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "knee",
+        "Expander Knee",
+        juce::NormalisableRange<float>(0.0f, 24.0f, 0.1f),
+        6.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(value, 1) + " dB"; }
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "range",
+        "Expander Range",
+        juce::NormalisableRange<float>(0.0f, 96.0f, 0.1f),
+        40.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(value, 1) + " dB"; }
+    ));
+
+    // Open bins close this far below the cutoff, so bins near it don't chatter from hop to hop
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "hysteresis",
+        "Hysteresis",
+        juce::NormalisableRange<float>(0.0f, 12.0f, 0.1f),
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(value, 1) + " dB"; }
+    ));
+
+    // Per-bin gain smoothing across hops: rising gains follow the attack, falling ones hold then release
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "attack",
+        "Attack",
+        juce::NormalisableRange<float>(0.0f, 200.0f, 0.1f, 0.5f),
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(value, 1) + " ms"; }
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "hold",
+        "Hold",
+        juce::NormalisableRange<float>(0.0f, 500.0f, 1.0f, 0.5f),
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(juce::roundToInt(value)) + " ms"; }
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "release",
+        "Release",
+        juce::NormalisableRange<float>(0.0f, 1000.0f, 1.0f, 0.5f),
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(juce::roundToInt(value)) + " ms"; }
+    ));
+
+    // Only bins between the two limits are gated, the rest pass untouched. The top of the high
+    // limit's range reaches up to Nyquist, whatever the sample rate.
+    const auto frequencyText = [](float value, int) {
+        return value < 1000.0f ? juce::String(juce::roundToInt(value)) + " Hz"
+                               : juce::String(value / 1000.0f, 1) + " kHz";
+    };
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "lowfreq",
+        "Low Limit",
+        juce::NormalisableRange<float>(0.0f, maxLimitHz, 1.0f, 0.25f),
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        frequencyText
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "highfreq",
+        "High Limit",
+        juce::NormalisableRange<float>(20.0f, maxLimitHz, 1.0f, 0.25f),
+        maxLimitHz,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        frequencyText
+    ));
+
     // FFT size parameter (0=64, 1=128, 2=256, 3=512, 4=1024, 5=2048)
     layout.add(std::make_unique<juce::AudioParameterChoice>(
         "fftsize",
@@ -44,6 +151,68 @@ juce::AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParam
         4  // Default to 1024
     ));
 
+    // How the FFT size is chosen: the "fftsize" choice as is, or from "windowtime" and the sample rate
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "resolution",
+        "Resolution",
+        juce::StringArray{"FFT Size", "Window Time"},
+        0
+    ));
+
+    // Analysis window duration, the bin spacing is its reciprocal whatever the sample rate
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "windowtime",
+        "Window Time",
+        juce::NormalisableRange<float>(1.0f, 50.0f, 0.1f, 0.5f),
+        21.3f,  // 1024 samples at 48 kHz
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(value, 1) + " ms (" + juce::String(juce::roundToInt(1000.0f / value)) + " Hz)"; }
+    ));
+
+    // Decimated runs the STFT at 44.1/48 kHz for higher host rates, the wet signal then stops at ~22 kHz
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "analysisrate",
+        "Analysis Rate",
+        juce::StringArray{"Full", "Decimated"},
+        0
+    ));
+
+    // What the mask listens to: the gated signal, the sidechain key, or whichever is louder per bin
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "detector",
+        "Detector",
+        juce::StringArray{"Main", "Key", "Main + Key"},
+        0
+    ));
+
+    // Background synthesises each frame on a worker thread, for one hop more latency and a flat per-block cost
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "fftthread",
+        "FFT Thread",
+        juce::StringArray{"Audio", "Background"},
+        0
+    ));
+
+    // Auto trades overlap and then FFT size below the configured size when processBlock runs over the CPU budget
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "quality",
+        "Quality",
+        juce::StringArray{"Fixed", "Auto"},
+        0
+    ));
+
+    // Fraction of each block's deadline that Auto quality lets processBlock take, on average
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "cpubudget",
+        "CPU Budget",
+        juce::NormalisableRange<float>(0.05f, 1.0f, 0.01f),
+        0.5f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        [](float value, int) { return juce::String(juce::roundToInt(value * 100.0f)) + "%"; }
+    ));
+
     return layout;
 }
 
@@ -53,6 +222,7 @@ PluginProcessor::PluginProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
@@ -63,31 +233,121 @@ PluginProcessor::PluginProcessor()
     weakStrongBalanceParam = parameters.getRawParameterValue("balance");
     dryWetParam = parameters.getRawParameterValue("drywet");
     fftSizeParam = parameters.getRawParameterValue("fftsize");
+    gateModeParam = parameters.getRawParameterValue("mode");
+    ratioParam = parameters.getRawParameterValue("ratio");
+    kneeParam = parameters.getRawParameterValue("knee");
+    rangeParam = parameters.getRawParameterValue("range");
+    resolutionParam = parameters.getRawParameterValue("resolution");
+    windowTimeParam = parameters.getRawParameterValue("windowtime");
+    analysisRateParam = parameters.getRawParameterValue("analysisrate");
+    detectorParam = parameters.getRawParameterValue("detector");
+    fftThreadParam = parameters.getRawParameterValue("fftthread");
+    qualityParam = parameters.getRawParameterValue("quality");
+    cpuBudgetParam = parameters.getRawParameterValue("cpubudget");
+    hysteresisParam = parameters.getRawParameterValue("hysteresis");
+    attackParam = parameters.getRawParameterValue("attack");
+    holdParam = parameters.getRawParameterValue("hold");
+    releaseParam = parameters.getRawParameterValue("release");
+    lowFreqParam = parameters.getRawParameterValue("lowfreq");
+    highFreqParam = parameters.getRawParameterValue("highfreq");
 
     // Initialize FFT with default size first
     currentFFTSize = 1024;
     currentFFTOrder = 10;
     currentHopSize = 256;
+    ceilingFFTOrder = 10;
+    qualityScheduler.setNumLevels(QualityScheduler::getNumLevels(ceilingFFTOrder, minFFTOrder));
+    
+    for (int order = minFFTOrder; order <= maxFFTOrder; ++order)
+    {
+        const auto index = static_cast<size_t>(order - minFFTOrder);
+        fftEngines[index] = std::make_unique<RealFFT>(order);
+        stereoEngines[index] = std::make_unique<StereoFFT>(order);
+        windowTables[index].resize(static_cast<size_t>(1 << order));
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(windowTables[index].data(), windowTables[index].size(),
+                                                                 juce::dsp::WindowingFunction<float>::hann, true);
+    }
     
-    forwardFFT = std::make_unique<juce::dsp::FFT>(currentFFTOrder);
-    window = std::make_unique<juce::dsp::WindowingFunction<float>>(
-        currentFFTSize, juce::dsp::WindowingFunction<float>::hann);
+    fft = fftEngines[static_cast<size_t>(currentFFTOrder - minFFTOrder)].get();
+    stereoFFT = stereoEngines[static_cast<size_t>(currentFFTOrder - minFFTOrder)].get();
+    window = windowTables[static_cast<size_t>(currentFFTOrder - minFFTOrder)].data();
     
-    fftData.resize(currentFFTSize * 2, 0.0f);
-    inputFIFO.resize(currentFFTSize, 0.0f);
-    outputFIFO.resize(currentFFTSize, 0.0f);
-    outputAccumulator.resize(currentFFTSize, 0.0f);
+    // Buffers are sized for the largest FFT so that size changes never reallocate
+    frameData.resize(maxFFTSize, 0.0f);
+    binReal.resize(maxFFTSize / 2 + 1, 0.0f);
+    binImag.resize(maxFFTSize / 2 + 1, 0.0f);
+    frameDataRight.resize(maxFFTSize, 0.0f);
+    binRealRight.resize(maxFFTSize / 2 + 1, 0.0f);
+    binImagRight.resize(maxFFTSize / 2 + 1, 0.0f);
+    keyFIFO.resize(maxFFTSize, 0.0f);
+    keyHistory.resize(maxFFTSize, 0.0f);
+    
+    // An Auto quality switch overlaps at most one old frame and one new frame plus the worker's hop
+    const int maxTransitionLength = maxFFTSize + maxFFTSize / 2 + 1;
+    fadeGain.resize(maxTransitionLength, 1.0f);
+    
+    for (auto& state : channelSTFT)
+    {
+        state.inputFIFO.resize(maxFFTSize, 0.0f);
+        state.outputFIFO.resize(maxFFTSize, 0.0f);
+        state.outputAccumulator.resize(maxFFTSize, 0.0f);
+        state.fadeOut.resize(maxTransitionLength, 0.0f);
+        state.history.resize(maxFFTSize, 0.0f);
+    }
     
     // Initialize spectrum data
-    spectrumMagnitudes.resize(currentFFTSize / 2, 0.0f);
-    spectrumGateStatus.resize(currentFFTSize / 2, false);
+    spectrumMagnitudes.resize(maxFFTSize / 2 + 1, 0.0f);
+    spectrumGateStatus.resize(maxFFTSize / 2 + 1, false);
+    spectrumNumBins = currentFFTSize / 2 + 1;
+    
+    // Per-bin scratch for the mask kernels
+    binPower.resize(maxFFTSize / 2 + 1, 0.0f);
+    keyPower.resize(maxFFTSize / 2 + 1, 0.0f);
+    binGains.resize(maxFFTSize / 2 + 1, 0.0f);
+    binDetection.resize(maxFFTSize / 2 + 1, 0.0f);
+    
+    for (auto& state : binStates)
+        state.allocate(maxFFTSize / 2 + 1);
+    
+    // Worker-side copies of a frame and its synthesised hop
+    for (auto& job : frameJobs)
+    {
+        for (auto& input : job.input)
+            input.resize(maxFFTSize, 0.0f);
+        
+        // The longest hop is half the largest FFT, at 50% overlap
+        for (auto& hop : job.hop)
+            hop.resize(maxFFTSize / 2, 0.0f);
+        
+        job.key.resize(maxFFTSize, 0.0f);
+    }
+    
+    frameWorker = std::make_unique<FrameWorker>([this] { runFrameJob(frameJobs[static_cast<size_t>(workerJob)]); });
+    maxFrameWaitTicks = juce::Time::secondsToHighResolutionTicks(0.001);
+    
+    // The worker thread follows the FFT Thread choice
+    parameters.addParameterListener("fftthread", this);
+    
+    // A usable default in case processBlock comes before prepareToPlay
+    dryBuffer.setSize(maxChannels, 512);
+    
+    // Filter histories for every main channel and the key at the largest factor, so enabling decimation never allocates
+    decimator.prepare(maxChannels + 1);
     
     // Now update to the parameter value (will do nothing if already 1024)
     updateFFTSize();
+    
+    // Picks up what the audio thread can only flag, as posting a message from it could block
+    startTimerHz(30);
 }
 
 PluginProcessor::~PluginProcessor()
 {
+    parameters.removeParameterListener("fftthread", this);
+    stopTimer();
+    
+    // The worker may be part way through a frame that uses the buffers below
+    frameWorker->stop();
 }
 
 //==============================================================================
@@ -158,25 +418,76 @@ void PluginProcessor::changeProgramName (int index, const juce::String& newName)
 //==============================================================================
 void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused (sampleRate, samplesPerBlock);
+    currentSampleRate = sampleRate;
     
-    // Update FFT size in case parameter changed
+    // Nothing may be in flight while the state below is reset
+    frameWorker->stop();
+    
+    // A worker that is part way through a frame gets a quarter of a block before its hop is repeated
+    maxFrameWaitTicks = juce::Time::secondsToHighResolutionTicks(0.25 * juce::jmax(1, samplesPerBlock) / sampleRate);
+    
+    // Scratch for the dry signal of every channel
+    dryBuffer.setSize(maxChannels, juce::jmax(1, samplesPerBlock), false, false, true);
+    
+    // Pick the FFT size and decimation for this sample rate
     updateFFTSize();
+    decimator.reset();
+    resetSTFT();
     
-    // Reset buffers
-    std::fill(fftData.begin(), fftData.end(), 0.0f);
-    std::fill(inputFIFO.begin(), inputFIFO.end(), 0.0f);
-    std::fill(outputFIFO.begin(), outputFIFO.end(), 0.0f);
-    std::fill(outputAccumulator.begin(), outputAccumulator.end(), 0.0f);
-    inputFIFOWritePos = 0;
-    outputFIFOReadPos = 0;
-    outputFIFOWritePos = 0;
+    // A new rate or block size means a new load, so Auto quality starts again from the top. A host
+    // restarting with the same settings, e.g. for a latency change, keeps the level it got to.
+    if (sampleRate != preparedSampleRate || samplesPerBlock != preparedBlockSize)
+        qualityScheduler.reset();
+    
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+    
+    const auto configuration = QualityScheduler::getConfiguration(ceilingFFTOrder, qualityScheduler.getLevel());
+    selectFFTConfiguration(configuration.order, configuration.getHopSize());
+    keyWasActive = false;
+    analysisSampleCount = 0;
+    
+    // Hosts read the latency once this returns, whichever thread they call it from
+    updateLatency();
+    publishLatency();
+    
+    // Only running while Background is selected; parameterChanged starts and stops it from then on
+    updateFrameWorkerThread();
 }
 
 void PluginProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // A frame still queued is run by the audio thread if processing resumes without prepareToPlay
+    frameWorker->stop();
+}
+
+void PluginProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    juce::ignoreUnused(parameterID, newValue);
+    
+    // Hosts may automate from the audio thread, which mustn't start or stop threads, or even post a message
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        updateFrameWorkerThread();
+    else
+        frameWorkerModeChanged.store(true, std::memory_order_release);
+}
+
+void PluginProcessor::timerCallback()
+{
+    if (frameWorkerModeChanged.exchange(false, std::memory_order_acquire))
+        updateFrameWorkerThread();
+    
+    if (latencyDirty.load(std::memory_order_acquire))
+        publishLatency();
+}
+
+void PluginProcessor::updateFrameWorkerThread()
+{
+    // Frames the audio thread submits before the worker is up, or after it stops, are run in place by collect()
+    if (juce::roundToInt(fftThreadParam->load()) == backgroundFFT)
+        frameWorker->start();
+    else
+        frameWorker->stop();
 }
 
 bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -195,6 +506,14 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain is optional, and mono or stereo when present
+    if (layouts.inputBuses.size() > 1)
+    {
+        const auto key = layouts.getChannelSet(true, 1);
+        if (!key.isDisabled() && key != juce::AudioChannelSet::mono() && key != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -221,143 +540,859 @@ void PluginProcessor::updateFFTSize()
     if (fftSizeParam == nullptr)
         return;
     
-    // Get FFT size from parameter (0=64, 1=128, 2=256, 3=512, 4=1024, 5=2048)
-    // AudioParameterChoice stores values as normalized floats, so convert back to index
-    const float normalizedValue = fftSizeParam->load();
-    const int sizeIndex = juce::roundToInt(normalizedValue * 5.0f);  // 6 options: 0-5
-    const int sizes[] = {64, 128, 256, 512, 1024, 2048};
-    const int newSize = sizes[juce::jlimit(0, 5, sizeIndex)];
+    // The raw value of an AudioParameterChoice is already the choice index
+    const bool decimate = juce::roundToInt(analysisRateParam->load()) == 1;
+    const int newFactor = decimate ? AnalysisDecimator::factorForSampleRate(currentSampleRate) : 1;
+    int newOrder;
+    
+    if (juce::roundToInt(resolutionParam->load()) == windowTimeResolution)
+    {
+        // Nearest power of two to the window duration at the rate the STFT actually runs at
+        const double windowSamples = windowTimeParam->load() * 0.001 * currentSampleRate / newFactor;
+        newOrder = juce::jlimit(minFFTOrder, maxFFTOrder, juce::roundToInt(std::log2(windowSamples)));
+    }
+    else
+    {
+        // Get FFT size from parameter (0=64, 1=128, 2=256, 3=512, 4=1024, 5=2048)
+        const int sizeIndex = juce::roundToInt(fftSizeParam->load());  // 6 options: 0-5
+        const int sizes[] = {64, 128, 256, 512, 1024, 2048};
+        newOrder = fftSizeToOrder(sizes[juce::jlimit(0, 5, sizeIndex)]);
+    }
+    
+    const bool newPipelined = juce::roundToInt(fftThreadParam->load()) == backgroundFFT;
+    
+    if (newOrder != ceilingFFTOrder || newFactor != decimator.getFactor() || newPipelined != pipelined)
+    {
+        // A frame in flight on the worker reads the sizes and engines switched below,
+        // so a worker that can't let go of it in time puts the change off to the next block
+        if (!frameWorker->cancel(maxFrameWaitTicks))
+            return;
+        
+        pipelined = newPipelined;
+        
+        // The chosen size is the top of the Auto quality ladder, which starts again from there
+        ceilingFFTOrder = newOrder;
+        qualityScheduler.setNumLevels(QualityScheduler::getNumLevels(ceilingFFTOrder, minFFTOrder));
+        // Histories are preallocated, so this only clears them when the factor changes.
+        // Set first, so the configuration published below has the new analysis rate.
+        decimator.setFactor(newFactor);
+        selectFFTConfiguration(newOrder, (1 << newOrder) / 4); // 75% overlap
+        
+        resetSTFT();
+        updateLatency();
+    }
+}
+
+void PluginProcessor::selectFFTConfiguration(int order, int hopSize)
+{
+    currentFFTOrder = order;
+    currentFFTSize = 1 << order;
+    currentHopSize = hopSize;
+    
+    // Switch to the prebuilt FFT and window for this size
+    fft = fftEngines[static_cast<size_t>(currentFFTOrder - minFFTOrder)].get();
+    stereoFFT = stereoEngines[static_cast<size_t>(currentFFTOrder - minFFTOrder)].get();
+    window = windowTables[static_cast<size_t>(currentFFTOrder - minFFTOrder)].data();
+    
+    publishedFFTSize.store(currentFFTSize, std::memory_order_relaxed);
+    publishedHopSize.store(currentHopSize, std::memory_order_relaxed);
+    publishedDecimationFactor.store(decimator.getFactor(), std::memory_order_relaxed);
+    publishedAnalysisSampleRate.store(currentSampleRate / decimator.getFactor(), std::memory_order_relaxed);
+}
+
+void PluginProcessor::switchFFTConfiguration(int order, int hopSize, int numChannels, bool useKey, bool hopDelivered)
+{
+    const int oldSize = currentFFTSize;
+    const int oldHopSize = currentHopSize;
+    const float* oldWindow = window;
+    const int newSize = 1 << order;
+    
+    // What the old configuration still has queued: completed samples not yet read (the hop just
+    // delivered by the worker, if any), then the overlap-add sums of the frames already processed.
+    // It plays out underneath the new configuration while the new frames build up.
+    const int numQueued = juce::jmin(oldHopSize + 1, (outputFIFOWritePos + (hopDelivered ? oldHopSize : 0) - outputFIFOReadPos + oldSize) % oldSize);
+    const int numPartial = oldSize - oldHopSize;
+    
+    // The worker delivers the new configuration's first hop a new hop later. Where that's longer than
+    // the old hop, the old queue would run out before the new frames have any weight, so the current
+    // frame is also finished here in the old configuration. That leaves the same overlap as in place.
+    const bool finishOldFrame = pipelined && hopSize > oldHopSize;
+    const int numCompleted = numQueued + (finishOldFrame ? oldHopSize : 0);
+    
+    // The new frames start from the newest input. A smaller configuration finds it at the end of
+    // the FIFOs, a larger one in the history, with silence before whatever the history doesn't cover.
+    const bool fromHistory = newSize > oldSize && historyLength > oldSize;
+    const int numValid = newSize <= oldSize ? newSize : (fromHistory ? juce::jmin(newSize, historyLength) : oldSize);
+    
+    const auto seed = [this, oldSize, newSize, fromHistory](float* fifo, const float* history) {
+        if (newSize <= oldSize)
+        {
+            std::copy(fifo + oldSize - newSize, fifo + oldSize, fifo);
+        }
+        else if (fromHistory)
+        {
+            readHistory(fifo, history, newSize);
+        }
+        else
+        {
+            std::copy_backward(fifo, fifo + oldSize, fifo + newSize);
+            juce::FloatVectorOperations::clear(fifo, newSize - oldSize);
+        }
+    };
+    
+    // The worker delivers the first new hop a frame later, and reads are one sample behind the writes
+    const int newDelay = 1 + (pipelined ? hopSize : 0);
+    const int transitionLength = juce::jmax(numCompleted + numPartial, newSize + newDelay);
+    const int clearSize = juce::jmax(oldSize, newSize);
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numQueued; ++i)
+            channelSTFT[channel].fadeOut[i] = channelSTFT[channel].outputFIFO[(outputFIFOReadPos + i) % oldSize];
+    
+    if (finishOldFrame)
+    {
+        std::array<const float*, maxChannels> inputs {};
+        std::array<float*, maxChannels> hopOutputs {};
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            inputs[channel] = channelSTFT[channel].inputFIFO.data();
+            hopOutputs[channel] = channelSTFT[channel].fadeOut.data() + numQueued;
+        }
+        
+        synthesiseFrame(inputs.data(), useKey ? keyFIFO.data() : nullptr, hopOutputs.data(), numChannels, analysisSampleCount);
+    }
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& state = channelSTFT[channel];
+        
+        std::copy(state.outputAccumulator.begin(), state.outputAccumulator.begin() + numPartial, state.fadeOut.begin() + numCompleted);
+        juce::FloatVectorOperations::clear(state.fadeOut.data() + numCompleted + numPartial, transitionLength - numCompleted - numPartial);
+        
+        seed(state.inputFIFO.data(), state.history.data());
+        juce::FloatVectorOperations::clear(state.outputFIFO.data(), clearSize);
+        juce::FloatVectorOperations::clear(state.outputAccumulator.data(), clearSize);
+    }
+    
+    if (useKey)
+        seed(keyFIFO.data(), keyHistory.data());
+    
+    // Every frame adds its window times the overlap gain to the samples it covers, and once all of a
+    // configuration's frames are in, those weights sum to 1. While the two overlap, dividing by the sum
+    // of the weights actually present from both makes the switch a crossfade whatever the hop sizes.
+    const float* newWindow = windowTables[static_cast<size_t>(order - minFFTOrder)].data();
+    const float oldGain = static_cast<float>(oldHopSize) / static_cast<float>(oldSize);
+    const float newGain = static_cast<float>(hopSize) / static_cast<float>(newSize);
     
-    if (newSize != currentFFTSize)
+    // Where neither has much weight, fade to silence rather than amplify
+    constexpr float minWeight = 0.1f;
+    
+    for (int i = 0; i < transitionLength; ++i)
     {
-        currentFFTSize = newSize;
-        currentFFTOrder = fftSizeToOrder(newSize);
-        currentHopSize = currentFFTSize / 4; // 75% overlap
+        float weight = i < numCompleted ? 1.0f : 0.0f;
         
-        // Recreate FFT and window
-        forwardFFT = std::make_unique<juce::dsp::FFT>(currentFFTOrder);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(
-            currentFFTSize, juce::dsp::WindowingFunction<float>::hann);
+        // The partial sums of the old frames, the newest of which wrote the hop just before them
+        if (i >= numCompleted && i < numCompleted + numPartial)
+            for (int index = i - numCompleted + oldHopSize; index < oldSize; index += oldHopSize)
+                weight += oldGain * oldWindow[index];
         
-        // Resize buffers
-        fftData.resize(currentFFTSize * 2, 0.0f);
-        inputFIFO.resize(currentFFTSize, 0.0f);
-        outputFIFO.resize(currentFFTSize, 0.0f);
-        outputAccumulator.resize(currentFFTSize, 0.0f);
+        // The new frames written so far, counting only the input that was really there
+        const int newPosition = i - newDelay;
         
-        // Reset positions
-        inputFIFOWritePos = 0;
-        outputFIFOReadPos = 0;
-        outputFIFOWritePos = 0;
+        if (newPosition >= newSize)
+            weight += 1.0f;
+        else if (newPosition >= newSize - numValid)
+            for (int index = newPosition; index >= 0; index -= hopSize)
+                weight += newGain * newWindow[index];
         
-        // Update spectrum data sizes
-        juce::ScopedLock lock(spectrumLock);
-        spectrumMagnitudes.resize(currentFFTSize / 2, 0.0f);
-        spectrumGateStatus.resize(currentFFTSize / 2, false);
+        fadeGain[i] = 1.0f / juce::jmax(weight, minWeight);
     }
+    
+    fadeOutLength = transitionLength;
+    fadeOutReadPos = 0;
+    
+    // The bins only keep their meaning when the size stays the same
+    if (newSize != oldSize)
+        for (auto& state : binStates)
+            state.reset();
+    
+    selectFFTConfiguration(order, hopSize);
+    
+    // The frame about to be processed is the new configuration's first. Reads keep the position they
+    // have at every frame boundary, one sample behind the hop this frame writes.
+    inputFIFOWritePos = currentFFTSize;
+    outputFIFOWritePos = 0;
+    outputFIFOReadPos = currentFFTSize - 1;
+    
+    updateLatency();
 }
 
-void PluginProcessor::processFFTFrame()
+void PluginProcessor::pushHistory(int numChannels, bool useKey, int numSamples)
 {
-    // Get parameter values
-    const float cutoffDB = cutoffAmplitudeParam->load();
-    const float cutoffLinear = juce::Decibels::decibelsToGain(cutoffDB);
-    const float balance = weakStrongBalanceParam->load();
+    // The samples just written to the input FIFOs. They're never more than a frame, so the ring wraps at most once.
+    const int firstPart = juce::jmin(numSamples, maxFFTSize - historyWritePos);
+    const int secondPart = numSamples - firstPart;
+    
+    const auto push = [this, firstPart, secondPart](const float* fifo, float* history) {
+        juce::FloatVectorOperations::copy(history + historyWritePos, fifo + inputFIFOWritePos, firstPart);
+        juce::FloatVectorOperations::copy(history, fifo + inputFIFOWritePos + firstPart, secondPart);
+    };
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+        push(channelSTFT[channel].inputFIFO.data(), channelSTFT[channel].history.data());
+    
+    if (useKey)
+        push(keyFIFO.data(), keyHistory.data());
     
-    // Copy input to FFT buffer
-    for (int i = 0; i < currentFFTSize; ++i)
+    historyWritePos = (historyWritePos + numSamples) % maxFFTSize;
+    historyLength = juce::jmin(maxFFTSize, historyLength + numSamples);
+}
+
+void PluginProcessor::readHistory(float* fifo, const float* history, int size) const
+{
+    // The newest samples go at the end, after silence for any the ring doesn't hold yet
+    const int numValid = juce::jmin(size, historyLength);
+    const int start = (historyWritePos - numValid + maxFFTSize) % maxFFTSize;
+    const int firstPart = juce::jmin(numValid, maxFFTSize - start);
+    
+    juce::FloatVectorOperations::clear(fifo, size - numValid);
+    juce::FloatVectorOperations::copy(fifo + size - numValid, history + start, firstPart);
+    juce::FloatVectorOperations::copy(fifo + size - numValid + firstPart, history, numValid - firstPart);
+}
+
+void PluginProcessor::updateLatency()
+{
+    // A frame's first hop is ready once the whole frame is in, and the worker holds it back one more hop
+    const int analysisLatency = currentFFTSize + (pipelined ? currentHopSize : 0);
+    targetLatency.store(analysisLatency * decimator.getFactor() + decimator.getLatencySamples(), std::memory_order_relaxed);
+    
+    // Changes made on the audio thread, such as an Auto quality step, are only flagged for timerCallback
+    // to report, as even posting a message can take a lock
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        publishLatency();
+    else
+        latencyDirty.store(true, std::memory_order_release);
+}
+
+void PluginProcessor::publishLatency()
+{
+    // Cleared first, so a change flagged while this runs is published on the next tick
+    latencyDirty.store(false, std::memory_order_relaxed);
+    setLatencySamples(targetLatency.load(std::memory_order_acquire));
+}
+
+void PluginProcessor::resetSTFT()
+{
+    // Drop any frame still on the worker, it belongs to the state cleared here. Callers have either
+    // stopped the worker or already cancelled, so this never has to wait.
+    frameWorker->cancel(maxFrameWaitTicks);
+    frameDeferred = false;
+    resyncNeeded = false;
+    
+    // Nothing to repeat yet if the worker misses its first frame
+    for (auto& job : frameJobs)
+        for (auto& hop : job.hop)
+            std::fill(hop.begin(), hop.end(), 0.0f);
+    
+    // Clear the streaming state (buffers are already sized for maxFFTSize)
+    std::fill(frameData.begin(), frameData.end(), 0.0f);
+    std::fill(frameDataRight.begin(), frameDataRight.end(), 0.0f);
+    std::fill(keyFIFO.begin(), keyFIFO.end(), 0.0f);
+    
+    for (auto& state : channelSTFT)
     {
-        fftData[i] = inputFIFO[i];
-        fftData[currentFFTSize + i] = 0.0f;
+        std::fill(state.inputFIFO.begin(), state.inputFIFO.end(), 0.0f);
+        std::fill(state.outputFIFO.begin(), state.outputFIFO.end(), 0.0f);
+        std::fill(state.outputAccumulator.begin(), state.outputAccumulator.end(), 0.0f);
     }
     
-    // Apply window
-    window->multiplyWithWindowingTable(fftData.data(), currentFFTSize);
+    // Reset positions
+    inputFIFOWritePos = 0;
+    outputFIFOReadPos = 0;
+    outputFIFOWritePos = 0;
+    fadeOutLength = 0;
+    fadeOutReadPos = 0;
+    historyLength = 0;
     
-    // Perform forward FFT
-    forwardFFT->performRealOnlyForwardTransform(fftData.data(), true);
+    for (auto& state : binStates)
+        state.reset();
+}
+
+void PluginProcessor::processSTFT(float* const* channels, int numChannels, const float* const* keyChannels, int numKeyChannels, int numSamples)
+{
+    int position = 0;
     
-    // Apply spectral gate
-    // FFT output is in format: [real0, real1, ..., realN/2, imag1, ..., imagN/2-1]
+    // Whole segments up to the end of the next frame, so each channel is one copy in and one copy out
+    while (position < numSamples)
     {
-        juce::ScopedLock lock(spectrumLock);
+        const int segment = juce::jmin(numSamples - position, currentFFTSize - inputFIFOWritePos);
         
-        for (int i = 0; i < currentFFTSize; i += 2)
+        for (int channel = 0; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::copy(channelSTFT[channel].inputFIFO.data() + inputFIFOWritePos, channels[channel] + position, segment);
+        
+        if (numKeyChannels > 0)
         {
-            float real = fftData[i];
-            float imag = fftData[i + 1];
-            float magnitude = std::sqrt(real * real + imag * imag);
+            // The key is detected in mono, as the average of its channels
+            auto* key = keyFIFO.data() + inputFIFOWritePos;
+            juce::FloatVectorOperations::copy(key, keyChannels[0] + position, segment);
             
-            // Store magnitude for visualization
-            int bin = i / 2;
-            if (bin < static_cast<int>(spectrumMagnitudes.size()))
-            {
-                spectrumMagnitudes[bin] = magnitude;
-                spectrumGateStatus[bin] = (magnitude >= cutoffLinear);
-            }
+            for (int channel = 1; channel < numKeyChannels; ++channel)
+                juce::FloatVectorOperations::add(key, keyChannels[channel] + position, segment);
+            
+            if (numKeyChannels > 1)
+                juce::FloatVectorOperations::multiply(key, 1.0f / static_cast<float>(numKeyChannels), segment);
+        }
+        
+        if (keepHistory)
+            pushHistory(numChannels, numKeyChannels > 0, segment);
+        
+        inputFIFOWritePos += segment;
+        analysisSampleCount += segment;
+        
+        // Same order as one sample at a time: everything before the last sample is read before the frame
+        readSTFTOutput(channels, numChannels, position, segment - 1);
+        
+        // When we have a full hop, process FFT
+        if (inputFIFOWritePos >= currentFFTSize)
+            processFFTFrame(numChannels, numKeyChannels > 0);
+        
+        readSTFTOutput(channels, numChannels, position + segment - 1, 1);
+        position += segment;
+    }
+}
+
+void PluginProcessor::processDecimatedSTFT(float* const* channels, int numChannels, const float* const* keyChannels, int numKeyChannels, int numSamples)
+{
+    // The decimator keeps the key in the channel after the main ones
+    constexpr int keyChannel = maxChannels;
+    
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            decimator.pushInput(channel, channels[channel][sample]);
+        
+        if (numKeyChannels > 0)
+        {
+            float key = 0.0f;
+            for (int channel = 0; channel < numKeyChannels; ++channel)
+                key += keyChannels[channel][sample];
             
-            if (magnitude < cutoffLinear)
+            decimator.pushInput(keyChannel, key / static_cast<float>(numKeyChannels));
+        }
+        
+        // The STFT only sees every factor-th (lowpassed) sample
+        if (decimator.isLowRateStep())
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                channelSTFT[channel].inputFIFO[inputFIFOWritePos] = decimator.getLowRateSample(channel);
+            
+            if (numKeyChannels > 0)
+                keyFIFO[inputFIFOWritePos] = decimator.getLowRateSample(keyChannel);
+            
+            if (keepHistory)
+                pushHistory(numChannels, numKeyChannels > 0, 1);
+            
+            inputFIFOWritePos++;
+            analysisSampleCount++;
+            
+            if (inputFIFOWritePos >= currentFFTSize)
+                processFFTFrame(numChannels, numKeyChannels > 0);
+            
+            // Crossfaded with the previous configuration's tail after an Auto quality switch
+            const bool fadingOut = fadeOutReadPos < fadeOutLength;
+            
+            for (int channel = 0; channel < numChannels; ++channel)
             {
-                // Below threshold - attenuate based on balance
-                // balance = 0: full attenuation (strong gate)
-                // balance = 1: no attenuation (weak gate)
-                float gain = balance;
-                fftData[i] *= gain;
-                fftData[i + 1] *= gain;
+                auto& state = channelSTFT[channel];
+                const float output = state.outputFIFO[outputFIFOReadPos];
+                decimator.pushLowRateOutput(channel, fadingOut ? (output + state.fadeOut[fadeOutReadPos]) * fadeGain[fadeOutReadPos] : output);
+                state.outputFIFO[outputFIFOReadPos] = 0.0f;
             }
+            
+            outputFIFOReadPos = (outputFIFOReadPos + 1) % currentFFTSize;
+            fadeOutReadPos += fadingOut ? 1 : 0;
         }
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][sample] = decimator.interpolate(channel);
+        
+        decimator.advance();
+    }
+}
+
+void PluginProcessor::readSTFTOutput(float* const* channels, int numChannels, int offset, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+    
+    // The output FIFO is circular, so the read may wrap once
+    const int firstPart = juce::jmin(numSamples, currentFFTSize - outputFIFOReadPos);
+    const int secondPart = numSamples - firstPart;
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* outputFIFO = channelSTFT[channel].outputFIFO.data();
+        juce::FloatVectorOperations::copy(channels[channel] + offset, outputFIFO + outputFIFOReadPos, firstPart);
+        juce::FloatVectorOperations::clear(outputFIFO + outputFIFOReadPos, firstPart);
+        juce::FloatVectorOperations::copy(channels[channel] + offset + firstPart, outputFIFO, secondPart);
+        juce::FloatVectorOperations::clear(outputFIFO, secondPart);
     }
     
-    // Perform inverse FFT
-    forwardFFT->performRealOnlyInverseTransform(fftData.data());
+    outputFIFOReadPos = (outputFIFOReadPos + numSamples) % currentFFTSize;
     
-    // Normalization factor for the FFT (JUCE doesn't normalize automatically)
-    const float normalizationFactor = 1.0f / static_cast<float>(currentFFTSize);
+    // Crossfaded with the previous configuration's tail after an Auto quality switch
+    const int numFadeOut = juce::jmin(numSamples, fadeOutLength - fadeOutReadPos);
     
-    // Add to output accumulator (overlap-add) with normalization
-    for (int i = 0; i < currentFFTSize; ++i)
+    if (numFadeOut > 0)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            juce::FloatVectorOperations::add(channels[channel] + offset, channelSTFT[channel].fadeOut.data() + fadeOutReadPos, numFadeOut);
+            juce::FloatVectorOperations::multiply(channels[channel] + offset, fadeGain.data() + fadeOutReadPos, numFadeOut);
+        }
+        
+        fadeOutReadPos += numFadeOut;
+    }
+}
+
+void PluginProcessor::forwardTransform(const float* input)
+{
     {
-        outputAccumulator[i] += fftData[i] * normalizationFactor;
+        SG_TRACE_SCOPE("window");
+        
+        // Copy input to the frame buffer and window it
+        juce::FloatVectorOperations::copy(frameData.data(), input, currentFFTSize);
+        kernels.applyWindow(frameData.data(), window, currentFFTSize);
     }
     
-    // Copy first hop to output FIFO
-    for (int i = 0; i < currentHopSize; ++i)
     {
-        outputFIFO[outputFIFOWritePos] = outputAccumulator[i];
-        outputFIFOWritePos = (outputFIFOWritePos + 1) % currentFFTSize;
+        SG_TRACE_SCOPE("forward FFT");
+        fft->forward(frameData.data(), binReal.data(), binImag.data());
     }
+}
+
+juce::Range<int> PluginProcessor::getActiveBins(int numBins) const
+{
+    // Bin k is centred on k times the analysis rate over the FFT size
+    const double binHz = getAnalysisSampleRate() / (2.0 * (numBins - 1));
+    const float low = lowFreqParam->load();
+    const float high = highFreqParam->load();
     
-    // Shift accumulator
-    for (int i = 0; i < currentFFTSize - currentHopSize; ++i)
+    const int start = juce::jlimit(0, numBins, static_cast<int>(std::ceil(low / binHz)));
+    const int end = high >= maxLimitHz ? numBins : juce::jlimit(0, numBins, static_cast<int>(std::floor(high / binHz)) + 1);
+    
+    // Limits that cross leave nothing to gate
+    return { start, juce::jmax(start, end) };
+}
+
+void PluginProcessor::updateBinRanges(int numBins)
+{
+    activeBins = getActiveBins(numBins);
+    
+    // The state kernels work on whole words of open bits, so the mask starts at a word boundary.
+    // The few bins below the band it computes are never applied.
+    const int maskStart = activeBins.getStart() - activeBins.getStart() % SpectralKernels::binsPerWord;
+    maskBins = { juce::jmin(maskStart, activeBins.getEnd()), activeBins.getEnd() };
+    
+    const bool displayAll = spectrogramRing.isConsumerActive() || captureRing.isConsumerActive();
+    measuredBins = displayAll ? juce::Range<int>(0, numBins) : maskBins;
+}
+
+void PluginProcessor::computeMask(const float* detectionPower, BinGateState& state)
+{
+    // Everything here runs over maskBins only
+    const int start = maskBins.getStart();
+    const int numBins = maskBins.getLength();
+    auto* openBits = state.openBits.data() + start / SpectralKernels::binsPerWord;
+    auto* detection = binDetection.data() + start;
+    auto* gains = binGains.data() + start;
+    state.setBand(start, maskBins.getEnd());
+    
+    const float cutoffDB = cutoffAmplitudeParam->load();
+    const float cutoffLinear = juce::Decibels::decibelsToGain(cutoffDB);
+    const float thresholdPower = cutoffLinear * cutoffLinear;
+    
+    // Bins that are open are judged against the cutoff minus the hysteresis, by raising their power by as much
+    const float openBoost = std::pow(10.0f, hysteresisParam->load() / 10.0f);
+    kernels.hysteresisDetection(detectionPower + start, detection, openBits, numBins, openBoost);
+    
+    if (juce::roundToInt(gateModeParam->load()) == expanderMode)
     {
-        outputAccumulator[i] = outputAccumulator[i + currentHopSize];
+        SpectralKernels::ExpanderCurve curve;
+        curve.thresholdDb = cutoffDB;
+        curve.ratio = ratioParam->load();
+        curve.kneeDb = kneeParam->load();
+        curve.rangeDb = rangeParam->load();
+        kernels.expanderGains(detection, gains, numBins, curve);
     }
-    for (int i = currentFFTSize - currentHopSize; i < currentFFTSize; ++i)
+    else
     {
-        outputAccumulator[i] = 0.0f;
+        // Below threshold - attenuate based on balance
+        // balance = 0: full attenuation (strong gate)
+        // balance = 1: no attenuation (weak gate)
+        const float balance = weakStrongBalanceParam->load();
+        kernels.gateGains(detection, gains, numBins, thresholdPower, balance);
     }
     
-    // Shift input FIFO
-    for (int i = 0; i < currentFFTSize - currentHopSize; ++i)
+    kernels.updateOpenBits(detection, openBits, numBins, thresholdPower);
+    
+    // Time constants become per-hop coefficients at the rate the STFT runs at. The first hop after
+    // a reset has nothing to smooth from, so it takes its gains as they are.
+    SpectralKernels::GainSmoothing smoothing;
+    
+    if (state.primed)
     {
-        inputFIFO[i] = inputFIFO[i + currentHopSize];
+        const float hopMilliseconds = static_cast<float>(1000.0 * currentHopSize / getAnalysisSampleRate());
+        const auto coefficient = [hopMilliseconds](float milliseconds) {
+            return milliseconds > 0.0f ? std::exp(-hopMilliseconds / milliseconds) : 0.0f;
+        };
+        
+        smoothing.attack = coefficient(attackParam->load());
+        smoothing.release = coefficient(releaseParam->load());
+        smoothing.holdHops = juce::roundToInt(holdParam->load() / hopMilliseconds);
     }
-    for (int i = currentFFTSize - currentHopSize; i < currentFFTSize; ++i)
+    
+    kernels.smoothGains(gains, state.gains.data() + start, state.holdCounters.data() + start, numBins, smoothing);
+    state.primed = true;
+}
+
+void PluginProcessor::processFFTFrame(int numChannels, bool useKey)
+{
+    SG_TRACE_SCOPE("processFFTFrame");
+    
+    // Pick up the hop synthesised from the previous frame, finishing it here if the worker is late
+    const bool hopDelivered = pipelined && frameWorker->isPending();
+    
+    if (pipelined && !collectFrameJobs(numChannels, useKey))
+    {
+        // The worker still has the previous frame, so this one waits in a job of its own
+        advanceFIFOs(numChannels, useKey);
+        return;
+    }
+    
+    // Auto quality moves between configurations at frame boundaries (see QualityScheduler.h)
+    const auto target = QualityScheduler::getConfiguration(ceilingFFTOrder, qualityScheduler.getLevel());
+    
+    if (target.order != currentFFTOrder || target.getHopSize() != currentHopSize)
+        switchFFTConfiguration(target.order, target.getHopSize(), numChannels, useKey, hopDelivered);
+    
+    if (pipelined)
+    {
+        // Hand this frame over in the job not holding the last delivered hop; its hop is delivered at the next frame boundary
+        workerJob = 1 - lastDeliveredJob;
+        fillFrameJob(frameJobs[static_cast<size_t>(workerJob)], numChannels, useKey);
+        frameWorker->submit();
+    }
+    else
+    {
+        std::array<const float*, maxChannels> inputs {};
+        std::array<float*, maxChannels> hopOutputs {};
+        
+        // The write position is always a whole number of hops, so a hop never wraps
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            inputs[channel] = channelSTFT[channel].inputFIFO.data();
+            hopOutputs[channel] = channelSTFT[channel].outputFIFO.data() + outputFIFOWritePos;
+        }
+        
+        synthesiseFrame(inputs.data(), useKey ? keyFIFO.data() : nullptr, hopOutputs.data(), numChannels, analysisSampleCount);
+    }
+    
+    advanceFIFOs(numChannels, useKey);
+}
+
+void PluginProcessor::advanceFIFOs(int numChannels, bool useKey)
+{
+    // Shift input FIFOs
+    for (int channel = 0; channel < numChannels; ++channel)
     {
-        inputFIFO[i] = 0.0f;
+        auto* inputFIFO = channelSTFT[channel].inputFIFO.data();
+        std::copy(inputFIFO + currentHopSize, inputFIFO + currentFFTSize, inputFIFO);
+        juce::FloatVectorOperations::clear(inputFIFO + currentFFTSize - currentHopSize, currentHopSize);
     }
     
+    if (useKey)
+    {
+        std::copy(keyFIFO.begin() + currentHopSize, keyFIFO.begin() + currentFFTSize, keyFIFO.begin());
+        juce::FloatVectorOperations::clear(keyFIFO.data() + currentFFTSize - currentHopSize, currentHopSize);
+    }
+    
+    outputFIFOWritePos = (outputFIFOWritePos + currentHopSize) % currentFFTSize;
     inputFIFOWritePos = currentFFTSize - currentHopSize;
 }
 
+bool PluginProcessor::collectFrameJobs(int numChannels, bool useKey)
+{
+    auto& lastJob = frameJobs[static_cast<size_t>(lastDeliveredJob)];
+    const bool wasPending = frameWorker->isPending();
+    
+    if (wasPending && frameWorker->collect(maxFrameWaitTicks) == FrameWorker::Collected::missed)
+    {
+        // Repeat the last hop in place of the one the worker owes, and keep this frame for the next boundary.
+        // Overwriting a frame that was already waiting loses it, so its overlap-add tail is out of step.
+        deliverFrameJob(lastJob, numChannels);
+        resyncNeeded = resyncNeeded || frameDeferred;
+        fillFrameJob(lastJob, numChannels, useKey);
+        frameDeferred = true;
+        return false;
+    }
+    
+    if (frameDeferred)
+    {
+        // The worker's hop is a boundary late, so it's dropped for the frame that waited here
+        if (resyncNeeded)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                juce::FloatVectorOperations::clear(channelSTFT[channel].outputAccumulator.data(), currentFFTSize);
+        }
+        
+        runFrameJob(lastJob);
+        deliverFrameJob(lastJob, numChannels);
+        frameDeferred = false;
+        resyncNeeded = false;
+    }
+    else if (wasPending)
+    {
+        deliverFrameJob(frameJobs[static_cast<size_t>(workerJob)], numChannels);
+        lastDeliveredJob = workerJob;
+    }
+    
+    return true;
+}
+
+void PluginProcessor::fillFrameJob(FrameJob& job, int numChannels, bool useKey)
+{
+    job.numChannels = numChannels;
+    job.useKey = useKey;
+    job.position = analysisSampleCount;
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::copy(job.input[channel].data(), channelSTFT[channel].inputFIFO.data(), currentFFTSize);
+    
+    if (useKey)
+        juce::FloatVectorOperations::copy(job.key.data(), keyFIFO.data(), currentFFTSize);
+}
+
+void PluginProcessor::runFrameJob(FrameJob& job)
+{
+    std::array<const float*, maxChannels> inputs {};
+    std::array<float*, maxChannels> hopOutputs {};
+    
+    for (int channel = 0; channel < job.numChannels; ++channel)
+    {
+        inputs[channel] = job.input[channel].data();
+        hopOutputs[channel] = job.hop[channel].data();
+    }
+    
+    synthesiseFrame(inputs.data(), job.useKey ? job.key.data() : nullptr, hopOutputs.data(), job.numChannels, job.position);
+}
+
+void PluginProcessor::deliverFrameJob(const FrameJob& job, int numChannels)
+{
+    for (int channel = 0; channel < juce::jmin(numChannels, job.numChannels); ++channel)
+        juce::FloatVectorOperations::copy(channelSTFT[channel].outputFIFO.data() + outputFIFOWritePos, job.hop[channel].data(), currentHopSize);
+}
+
+void PluginProcessor::synthesiseFrame(const float* const* inputs, const float* key, float* const* hopOutputs, int numChannels, int64_t position)
+{
+    // DC to Nyquist inclusive
+    const int numBins = fft->getNumBins();
+    const int detector = juce::roundToInt(detectorParam->load());
+    const bool useKey = key != nullptr;
+    updateBinRanges(numBins);
+    
+    // Key spectrum through the same FFT plan and scratch as the main channels
+    if (useKey)
+    {
+        SG_TRACE_SCOPE("key");
+        forwardTransform(key);
+        const int start = measuredBins.getStart();
+        kernels.computePower(binReal.data() + start, binImag.data() + start, keyPower.data() + start, measuredBins.getLength());
+    }
+    
+    // Key-only detection gives every channel the same mask, so it's computed once
+    const bool sharedMask = useKey && detector == keyDetector;
+    
+    if (sharedMask)
+    {
+        SG_TRACE_SCOPE("mask");
+        computeMask(keyPower.data(), binStates[0]);
+    }
+    
+    // Stereo frames pack both channels into one complex FFT each way (see StereoFFT.h)
+    if (numChannels == 2)
+    {
+        synthesiseStereoFrame(inputs, hopOutputs, sharedMask, useKey, position);
+        return;
+    }
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        forwardTransform(inputs[channel]);
+        
+        // Bins 0..N/2 in split planes, see RealFFT.h
+        gateBins(binReal.data(), binImag.data(), sharedMask, useKey, channel);
+        
+        // The displays and capture follow the first channel's detector
+        if (channel == 0)
+            publishAnalysisFrame(sharedMask ? keyPower.data() : binPower.data(), numBins, binStates[0].openBits.data(), position);
+        
+        {
+            SG_TRACE_SCOPE("inverse FFT");
+            fft->inverse(binReal.data(), binImag.data(), frameData.data());
+        }
+        
+        overlapAddHop(channel, frameData.data(), hopOutputs[channel]);
+    }
+}
+
+void PluginProcessor::synthesiseStereoFrame(const float* const* inputs, float* const* hopOutputs, bool sharedMask, bool useKey, int64_t position)
+{
+    const int numBins = stereoFFT->getNumBins();
+    
+    {
+        SG_TRACE_SCOPE("window");
+        juce::FloatVectorOperations::copy(frameData.data(), inputs[0], currentFFTSize);
+        juce::FloatVectorOperations::copy(frameDataRight.data(), inputs[1], currentFFTSize);
+        kernels.applyWindow(frameData.data(), window, currentFFTSize);
+        kernels.applyWindow(frameDataRight.data(), window, currentFFTSize);
+    }
+    
+    {
+        SG_TRACE_SCOPE("forward FFT");
+        stereoFFT->forward(frameData.data(), frameDataRight.data(),
+                           binReal.data(), binImag.data(), binRealRight.data(), binImagRight.data());
+    }
+    
+    // Each channel is masked exactly as on the per-channel path; binPower still holds the left one when it's published
+    gateBins(binReal.data(), binImag.data(), sharedMask, useKey, 0);
+    publishAnalysisFrame(sharedMask ? keyPower.data() : binPower.data(), numBins, binStates[0].openBits.data(), position);
+    gateBins(binRealRight.data(), binImagRight.data(), sharedMask, useKey, 1);
+    
+    {
+        SG_TRACE_SCOPE("inverse FFT");
+        stereoFFT->inverse(binReal.data(), binImag.data(), binRealRight.data(), binImagRight.data(),
+                           frameData.data(), frameDataRight.data());
+    }
+    
+    overlapAddHop(0, frameData.data(), hopOutputs[0]);
+    overlapAddHop(1, frameDataRight.data(), hopOutputs[1]);
+}
+
+void PluginProcessor::gateBins(float* real, float* imag, bool sharedMask, bool useKey, int channel)
+{
+    SG_TRACE_SCOPE("mask");
+    
+    // With a shared mask binGains already holds the key's gains
+    if (!sharedMask)
+    {
+        // Only the first channel's power is published
+        const auto bins = channel == 0 ? measuredBins : maskBins;
+        const int start = bins.getStart();
+        kernels.computePower(real + start, imag + start, binPower.data() + start, bins.getLength());
+        
+        // Combined detection: a bin opens when either signal is above the threshold
+        if (useKey)
+            juce::FloatVectorOperations::max(binPower.data() + start, binPower.data() + start, keyPower.data() + start, bins.getLength());
+        
+        computeMask(binPower.data(), binStates[channel]);
+    }
+    
+    // Bins outside the band pass untouched
+    const int start = activeBins.getStart();
+    kernels.applyGains(real + start, imag + start, binGains.data() + start, activeBins.getLength());
+}
+
+void PluginProcessor::overlapAddHop(int channel, const float* frame, float* hopOutput)
+{
+    SG_TRACE_SCOPE("overlap-add");
+    
+    // The inverse is already scaled by 1/N and the window has a mean of 1, so
+    // only the N / hop frames overlapping each sample need dividing out
+    const float overlapGain = static_cast<float>(currentHopSize) / static_cast<float>(currentFFTSize);
+    
+    // Add to output accumulator (overlap-add)
+    auto* accumulator = channelSTFT[channel].outputAccumulator.data();
+    kernels.overlapAdd(accumulator, frame, overlapGain, currentFFTSize);
+    
+    // The first hop is complete
+    juce::FloatVectorOperations::copy(hopOutput, accumulator, currentHopSize);
+    
+    // Shift accumulator
+    std::copy(accumulator + currentHopSize, accumulator + currentFFTSize, accumulator);
+    juce::FloatVectorOperations::clear(accumulator + currentFFTSize - currentHopSize, currentHopSize);
+}
+
+void PluginProcessor::publishAnalysisFrame(const float* detectionPower, int numBins, const uint32_t* openBits, int64_t position)
+{
+    // Only pay for quantising the spectrogram frame while an editor is draining the ring
+    auto spectrogramFrame = spectrogramRing.isConsumerActive()
+                                ? spectrogramRing.startFrame(numBins)
+                                : SpectrogramFrameRing::FrameWriter();
+    
+    // Same for capture, which gets the very same quantised levels
+    auto captureFrame = captureRing.isConsumerActive()
+                            ? captureRing.startFrame(numBins, position, currentHopSize)
+                            : SpectrogramFrameRing::FrameWriter();
+    const bool quantiseLevels = spectrogramFrame.isValid() || captureFrame.isValid();
+    
+    // Hann window has a coherent gain of 0.5, so this maps a full scale sine to 1.0
+    const float spectrogramScale = 4.0f / static_cast<float>(currentFFTSize);
+    
+    {
+        // Never wait for the editor: if it's busy copying, skip publishing this frame
+        const juce::ScopedTryLock lock(spectrumLock);
+        const bool publishSpectrum = lock.isLocked();
+        
+        if (publishSpectrum || quantiseLevels)
+        {
+            if (publishSpectrum)
+                spectrumNumBins = numBins;
+            
+            for (int bin = 0; bin < numBins; ++bin)
+            {
+                // Bins outside the band show as open, as they pass untouched
+                const float magnitude = measuredBins.contains(bin) ? std::sqrt(detectionPower[bin]) : 0.0f;
+                const bool open = !activeBins.contains(bin) || SpectralKernels::isBinOpen(openBits, bin);
+                
+                // Store magnitude for visualization
+                if (publishSpectrum)
+                {
+                    spectrumMagnitudes[bin] = magnitude;
+                    spectrumGateStatus[bin] = open;
+                }
+                
+                if (quantiseLevels)
+                {
+                    const auto level = SpectrogramFrameRing::quantiseLevel(magnitude * spectrogramScale);
+                    
+                    if (spectrogramFrame.isValid())
+                        spectrogramFrame.setLevel(bin, level, open);
+                    
+                    if (captureFrame.isValid())
+                        captureFrame.setLevel(bin, level, open);
+                }
+            }
+        }
+    }
+    
+    spectrogramRing.finishFrame(spectrogramFrame);
+    captureRing.finishFrame(captureFrame);
+}
+
 void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
     juce::ignoreUnused (midiMessages);
+    SG_TRACE_SCOPE("processBlock");
+    
+    // Auto quality is driven by how long this call takes
+    const auto startTicks = juce::Time::getHighResolutionTicks();
 
     juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    auto totalNumInputChannels  = getMainBusNumInputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
 
     // Clear unused output channels
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
@@ -365,45 +1400,89 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 
     // Check if FFT size changed
     updateFFTSize();
+    
+    // Fixed quality stays at the top of the ladder, and Auto starts from there
+    const bool autoQuality = juce::roundToInt(qualityParam->load()) == autoQualityMode;
+    
+    if (!autoQuality)
+    {
+        qualityScheduler.reset();
+        historyLength = 0;
+    }
+    
+    keepHistory = autoQuality;
 
     // Get dry/wet parameter
     const float dryWet = dryWetParam->load();
 
     const int numSamples = buffer.getNumSamples();
     
-    // Process each channel
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    // The sidechain's channels come after the main ones, so go through the buses
+    auto mainBuffer = getBusBuffer(buffer, true, 0);
+    const int numChannels = juce::jmin(maxChannels, totalNumInputChannels, mainBuffer.getNumChannels());
+    
+    // A disconnected key (or the main detector) costs no FFT work at all
+    const int numConnectedKeyChannels = getBusCount(true) > 1 ? getChannelCountOfBus(true, 1) : 0;
+    const bool useKey = numConnectedKeyChannels > 0 && juce::roundToInt(detectorParam->load()) != mainDetector;
+    const int numKeyChannels = useKey ? juce::jmin(maxChannels, numConnectedKeyChannels) : 0;
+    
+    // The key FIFO isn't fed while unused, so start it from silence when the key takes over
+    if (useKey && !keyWasActive)
+    {
+        std::fill(keyFIFO.begin(), keyFIFO.end(), 0.0f);
+        std::fill(keyHistory.begin(), keyHistory.end(), 0.0f);
+    }
+    
+    keyWasActive = useKey;
+    
+    // Hosts may exceed the block size given to prepareToPlay, so work in chunks that fit dryBuffer
+    const int maxChunkSize = dryBuffer.getNumSamples();
+    
+    for (int chunkStart = 0; chunkStart < numSamples; chunkStart += maxChunkSize)
     {
-        auto* channelData = buffer.getWritePointer (channel);
+        const int chunkSize = juce::jmin(maxChunkSize, numSamples - chunkStart);
         
-        // Store dry signal for mixing later
-        std::vector<float> drySignal(channelData, channelData + numSamples);
+        std::array<float*, maxChannels> channels {};
+        std::array<const float*, maxChannels> keyChannels {};
         
-        // Process each sample
-        for (int sample = 0; sample < numSamples; ++sample)
+        for (int channel = 0; channel < numChannels; ++channel)
         {
-            // Add sample to input FIFO
-            inputFIFO[inputFIFOWritePos] = channelData[sample];
-            inputFIFOWritePos++;
+            channels[channel] = mainBuffer.getWritePointer(channel) + chunkStart;
             
-            // When we have a full hop, process FFT
-            if (inputFIFOWritePos >= currentFFTSize)
-            {
-                processFFTFrame();
-            }
+            // Store dry signal for mixing later
+            dryBuffer.copyFrom(channel, 0, channels[channel], chunkSize);
+        }
+        
+        if (useKey)
+        {
+            auto keyBuffer = getBusBuffer(buffer, true, 1);
+            for (int channel = 0; channel < numKeyChannels; ++channel)
+                keyChannels[channel] = keyBuffer.getReadPointer(channel) + chunkStart;
+        }
+        
+        {
+            SG_TRACE_SCOPE("STFT");
             
-            // Get output from output FIFO
-            channelData[sample] = outputFIFO[outputFIFOReadPos];
-            outputFIFO[outputFIFOReadPos] = 0.0f;
-            outputFIFOReadPos = (outputFIFOReadPos + 1) % currentFFTSize;
+            if (decimator.getFactor() == 1)
+                processSTFT(channels.data(), numChannels, keyChannels.data(), numKeyChannels, chunkSize);
+            else
+                processDecimatedSTFT(channels.data(), numChannels, keyChannels.data(), numKeyChannels, chunkSize);
         }
         
-        // Apply dry/wet mix
-        for (int i = 0; i < numSamples; ++i)
         {
-            channelData[i] = drySignal[i] * (1.0f - dryWet) + channelData[i] * dryWet;
+            SG_TRACE_SCOPE("dry/wet mix");
+            
+            for (int channel = 0; channel < numChannels; ++channel)
+                kernels.mixDryWet(channels[channel], dryBuffer.getReadPointer(channel), dryWet, chunkSize);
         }
     }
+    
+    // Any step is taken at the next frame boundary
+    if (autoQuality)
+    {
+        const double elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        qualityScheduler.addBlock(elapsedSeconds, numSamples / currentSampleRate, cpuBudgetParam->load(), ceilingFFTOrder);
+    }
 }
 
 //==============================================================================
@@ -434,11 +1513,34 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
             parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
 }
 
+bool PluginProcessor::startCapture(const juce::File& file)
+{
+    stopCapture();
+    
+    AnalysisCapture::Format format;
+    format.fftSize = getFFTSize();
+    format.hopSize = getHopSize();
+    format.sampleRate = getAnalysisSampleRate();
+    
+    auto writer = std::make_unique<AnalysisCaptureWriter>(captureRing, file, format);
+    
+    if (!writer->start())
+        return false;
+    
+    captureWriter = std::move(writer);
+    return true;
+}
+
+void PluginProcessor::stopCapture()
+{
+    captureWriter.reset();
+}
+
 void PluginProcessor::getSpectrumData(std::vector<float>& magnitudes, std::vector<bool>& gateStatus)
 {
     juce::ScopedLock lock(spectrumLock);
-    magnitudes = spectrumMagnitudes;
-    gateStatus = spectrumGateStatus;
+    magnitudes.assign(spectrumMagnitudes.begin(), spectrumMagnitudes.begin() + spectrumNumBins);
+    gateStatus.assign(spectrumGateStatus.begin(), spectrumGateStatus.begin() + spectrumNumBins);
 }
 
 //==============================================================================
@@ -2,12 +2,24 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
+#include "AnalysisCapture.h"
+#include "AnalysisDecimator.h"
+#include "BinGateState.h"
+#include "FrameWorker.h"
+#include "KernelDispatch.h"
+#include "QualityScheduler.h"
+#include "RealFFT.h"
+#include "SpectrogramFrameRing.h"
+#include "StereoFFT.h"
+#include "StageTracer.h"
 
 #if (MSVC)
 #include "ipps.h"
 #endif
 
-class PluginProcessor : public juce::AudioProcessor
+class PluginProcessor : public juce::AudioProcessor,
+                        private juce::AudioProcessorValueTreeState::Listener,
+                        private juce::Timer
 {
 public:
     PluginProcessor();
@@ -44,7 +56,40 @@ public:
     
     // Spectrum data access for visualization
     void getSpectrumData(std::vector<float>& magnitudes, std::vector<bool>& gateStatus);
-    int getFFTSize() const { return currentFFTSize; }
+    int getFFTSize() const { return publishedFFTSize.load(std::memory_order_relaxed); }
+    
+    // Range of the FFT sizes the STFT can run at
+    static constexpr int minFFTOrder = 6;   // 64 samples
+    static constexpr int maxFFTOrder = 11;  // 2048 samples
+    
+    // The STFT runs at the host rate divided by this (see AnalysisDecimator)
+    int getDecimationFactor() const { return publishedDecimationFactor.load(std::memory_order_relaxed); }
+    double getAnalysisSampleRate() const { return publishedAnalysisSampleRate.load(std::memory_order_relaxed); }
+
+    // Per-hop frames for the scrolling spectrogram, drained by the editor
+    SpectrogramFrameRing& getSpectrogramRing() { return spectrogramRing; }
+
+    // QA capture of every hop's levels and gate mask to a .sgcap file (see AnalysisCapture.h)
+    // Message thread only. Starting a new capture finishes the previous one.
+    bool startCapture(const juce::File& file);
+    void stopCapture();
+    bool isCapturing() const { return captureWriter != nullptr; }
+
+    // Whether frames are synthesised on the background worker, a hop later (see FrameWorker.h)
+    bool isFFTPipelined() const { return pipelined; }
+    int64_t getNumLateFrames() const { return frameWorker->getNumLateFrames(); }
+    int64_t getNumMissedFrames() const { return frameWorker->getNumMissedFrames(); }
+    
+    // The worker thread only runs while the FFT Thread is set to Background
+    bool isFFTWorkerRunning() const { return frameWorker->isRunning(); }
+    
+    // Auto quality: the level is picked after each block and applied at the next frame (see QualityScheduler.h)
+    QualityScheduler& getQualityScheduler() { return qualityScheduler; }
+    int getHopSize() const { return publishedHopSize.load(std::memory_order_relaxed); }
+    
+    // Bins [start, end) of an N/2 + 1 bin frame that lie between the Low and High Limits
+    static constexpr float maxLimitHz = 20000.0f;
+    juce::Range<int> getActiveBins(int numBins) const;
 
 private:
     // Parameters
@@ -53,36 +98,239 @@ private:
     std::atomic<float>* weakStrongBalanceParam = nullptr;
     std::atomic<float>* dryWetParam = nullptr;
     std::atomic<float>* fftSizeParam = nullptr;
+    std::atomic<float>* gateModeParam = nullptr;
+    std::atomic<float>* ratioParam = nullptr;
+    std::atomic<float>* kneeParam = nullptr;
+    std::atomic<float>* rangeParam = nullptr;
+    std::atomic<float>* resolutionParam = nullptr;
+    std::atomic<float>* windowTimeParam = nullptr;
+    std::atomic<float>* analysisRateParam = nullptr;
+    std::atomic<float>* detectorParam = nullptr;
+    std::atomic<float>* fftThreadParam = nullptr;
+    std::atomic<float>* qualityParam = nullptr;
+    std::atomic<float>* cpuBudgetParam = nullptr;
+    std::atomic<float>* hysteresisParam = nullptr;
+    std::atomic<float>* attackParam = nullptr;
+    std::atomic<float>* holdParam = nullptr;
+    std::atomic<float>* releaseParam = nullptr;
+    std::atomic<float>* lowFreqParam = nullptr;
+    std::atomic<float>* highFreqParam = nullptr;
+
+    // Choice indices of the "mode" parameter
+    static constexpr int gateMode = 0;
+    static constexpr int expanderMode = 1;
+    
+    // Choice indices of the "resolution" parameter
+    static constexpr int fixedSizeResolution = 0;
+    static constexpr int windowTimeResolution = 1;
+    
+    // Choice indices of the "detector" parameter
+    static constexpr int mainDetector = 0;
+    static constexpr int keyDetector = 1;
+    static constexpr int combinedDetector = 2;
+    
+    // Choice indices of the "fftthread" parameter
+    static constexpr int audioThreadFFT = 0;
+    static constexpr int backgroundFFT = 1;
+    
+    // Choice indices of the "quality" parameter
+    static constexpr int fixedQualityMode = 0;
+    static constexpr int autoQualityMode = 1;
+    
+    // The main bus is mono or stereo, and so is the sidechain
+    static constexpr int maxChannels = 2;
 
     // FFT processing - now dynamic
-    static constexpr int maxFFTOrder = 11;  // 2048 samples
     static constexpr int maxFFTSize = 1 << maxFFTOrder;
+    static constexpr int numFFTSizes = maxFFTOrder - minFFTOrder + 1;
     
     int currentFFTOrder = 10;  // Default 1024 samples
     int currentFFTSize = 1024;
     int currentHopSize = 256;  // 75% overlap
+    int ceilingFFTOrder = 10;  // the size the parameters ask for, which Auto quality may go below
+    bool pipelined = false;
+    double currentSampleRate = 44100.0;
+    
+    // Copies of the configuration above for the editor and other message-thread readers,
+    // stored by selectFFTConfiguration on whichever thread switches it
+    std::atomic<int> publishedFFTSize { 1024 };
+    std::atomic<int> publishedHopSize { 256 };
+    std::atomic<int> publishedDecimationFactor { 1 };
+    std::atomic<double> publishedAnalysisSampleRate { 44100.0 };
+    
+    // One FFT and window per selectable size, built up front so that
+    // switching sizes on the audio thread never allocates. Stereo frames go
+    // through stereoFFT, both channels in one complex transform.
+    std::array<std::unique_ptr<RealFFT>, numFFTSizes> fftEngines;
+    std::array<std::unique_ptr<StereoFFT>, numFFTSizes> stereoEngines;
+    std::array<std::vector<float>, numFFTSizes> windowTables;
+    RealFFT* fft = nullptr;
+    StereoFFT* stereoFFT = nullptr;
+    const float* window = nullptr;
+    
+    // The hot loops, built for the best instruction set this CPU has (see KernelDispatch.h)
+    const SpectralKernels::KernelTable& kernels = SpectralKernels::getKernels();
+    
+    // Streaming state of one main channel; every channel shares the FIFO positions below
+    struct ChannelSTFT
+    {
+        std::vector<float> inputFIFO;
+        std::vector<float> outputFIFO;
+        std::vector<float> outputAccumulator;
+        
+        // What the previous configuration still had queued, played out after an Auto quality switch
+        std::vector<float> fadeOut;
+        
+        // The newest input, kept in Auto quality mode so a larger FFT starts from a full frame
+        std::vector<float> history;
+    };
+    
+    std::array<ChannelSTFT, maxChannels> channelSTFT;
     
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+    // Mono sum of the sidechain, only fed while the key drives the mask
+    std::vector<float> keyFIFO;
+    bool keyWasActive = false;
     
-    std::vector<float> fftData;
-    std::vector<float> inputFIFO;
-    std::vector<float> outputFIFO;
-    std::vector<float> outputAccumulator;
+    // FFT scratch shared by every channel and the key: the windowed frame (and the
+    // inverse output), then the N/2 + 1 bins as split real and imaginary planes
+    std::vector<float> frameData;
+    std::vector<float> binReal;
+    std::vector<float> binImag;
+    
+    // The second channel's frame and bins, only used by stereo frames
+    std::vector<float> frameDataRight;
+    std::vector<float> binRealRight;
+    std::vector<float> binImagRight;
+    
+    // Per-bin power and gain for the mask kernels
+    std::vector<float> binPower;
+    std::vector<float> keyPower;
+    std::vector<float> binGains;
+    
+    // Detection power after the hysteresis, what the gain kernels actually see
+    std::vector<float> binDetection;
+    
+    // Each channel's bin states across hops, the first channel's also serving a shared key mask
+    std::array<BinGateState, maxChannels> binStates;
+    
+    // This frame's bins: those gated, those the mask and its state run over (from the start of an
+    // open-bits word), and those whose power is measured, every bin while an editor or capture wants them
+    juce::Range<int> activeBins;
+    juce::Range<int> maskBins;
+    juce::Range<int> measuredBins;
+    
+    // Moves the STFT to a lower rate at high host sample rates, histories sized in prepareToPlay
+    AnalysisDecimator decimator;
+    
+    // Dry copy of each channel for the dry/wet mix, sized in prepareToPlay
+    juce::AudioBuffer<float> dryBuffer;
     
     int inputFIFOWritePos = 0;
     int outputFIFOReadPos = 0;
     int outputFIFOWritePos = 0;
+    int fadeOutReadPos = 0;
+    int fadeOutLength = 0;
+    
+    // Shared by the channels: 1 over the summed frame weights of both configurations while they overlap
+    std::vector<float> fadeGain;
+    
+    // Ring of the newest input samples, and how many of them are valid
+    std::vector<float> keyHistory;
+    int historyWritePos = 0;
+    int historyLength = 0;
+    bool keepHistory = false;
+    
+    QualityScheduler qualityScheduler;
+    
+    // What prepareToPlay was last called with, so a restart with the same settings keeps the Auto level
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
     
-    // Spectrum data for visualization
+    // Latency for the current configuration. Hosts restart processing when it changes, so it's only
+    // passed to setLatencySamples from prepareToPlay or the message thread. Changes made on the
+    // audio thread set latencyDirty, which timerCallback polls (see updateLatency).
+    std::atomic<int> targetLatency { 0 };
+    std::atomic<bool> latencyDirty { false };
+    
+    // Spectrum data for visualization, sized for maxFFTSize
+    // The audio thread only ever try-locks, so the editor can never stall it
     std::vector<float> spectrumMagnitudes;
     std::vector<bool> spectrumGateStatus;
+    int spectrumNumBins = 0;
     juce::CriticalSection spectrumLock;
+    SpectrogramFrameRing spectrogramRing { 256, maxFFTSize / 2 + 1 };
+    
+    // Drained by captureWriter, which must be destroyed before the ring
+    SpectrogramFrameRing captureRing { 512, maxFFTSize / 2 + 1 };
+    std::unique_ptr<AnalysisCaptureWriter> captureWriter;
+    
+    // Analysis-rate samples fed to the STFT since prepareToPlay, stamped on captured frames
+    int64_t analysisSampleCount = 0;
+    
+    // A frame handed to the worker: copies of its inputs, and the hop it synthesises
+    struct FrameJob
+    {
+        std::array<std::vector<float>, maxChannels> input;
+        std::vector<float> key;
+        std::array<std::vector<float>, maxChannels> hop;
+        int numChannels = 0;
+        bool useKey = false;
+        int64_t position = 0;
+    };
+    
+    // Two jobs, so a frame can wait on the audio thread while the worker is late with the one before.
+    // Jobs alternate, so the last delivered hop stays in its job until the next-but-one frame.
+    std::array<FrameJob, 2> frameJobs;
+    int workerJob = 0;
+    int lastDeliveredJob = 1;
+    
+    // A frame waiting in the last delivered job for a late worker, and whether an earlier one was dropped
+    bool frameDeferred = false;
+    bool resyncNeeded = false;
+    
+    // How long the audio thread spins on a worker that is part way through a frame, set in prepareToPlay
+    int64_t maxFrameWaitTicks = 0;
+    
+    // Runs only while Background is selected (see updateFrameWorkerThread), and stopped before any of the state above goes away
+    std::unique_ptr<FrameWorker> frameWorker;
+    
+    // Set when the FFT Thread changes off the message thread, for timerCallback to start or stop the worker
+    std::atomic<bool> frameWorkerModeChanged { false };
+
+   #if SPECTRAL_GATE_TRACING
+    juce::SharedResourcePointer<SharedStageTracer> sharedTracer;
+   #endif
 
     // Helper method to create parameter layout
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
-    void processFFTFrame();
+    void processSTFT(float* const* channels, int numChannels, const float* const* keyChannels, int numKeyChannels, int numSamples);
+    void processDecimatedSTFT(float* const* channels, int numChannels, const float* const* keyChannels, int numKeyChannels, int numSamples);
+    void readSTFTOutput(float* const* channels, int numChannels, int offset, int numSamples);
+    void processFFTFrame(int numChannels, bool useKey);
+    void advanceFIFOs(int numChannels, bool useKey);
+    void synthesiseFrame(const float* const* inputs, const float* key, float* const* hopOutputs, int numChannels, int64_t position);
+    void runFrameJob(FrameJob& job);
+    void fillFrameJob(FrameJob& job, int numChannels, bool useKey);
+    void deliverFrameJob(const FrameJob& job, int numChannels);
+    bool collectFrameJobs(int numChannels, bool useKey);
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void timerCallback() override;
+    void publishLatency();
+    void updateFrameWorkerThread();
+    void synthesiseStereoFrame(const float* const* inputs, float* const* hopOutputs, bool sharedMask, bool useKey, int64_t position);
+    void forwardTransform(const float* input);
+    void gateBins(float* real, float* imag, bool sharedMask, bool useKey, int channel);
+    void overlapAddHop(int channel, const float* frame, float* hopOutput);
+    void updateBinRanges(int numBins);
+    void computeMask(const float* detectionPower, BinGateState& state);
+    void publishAnalysisFrame(const float* detectionPower, int numBins, const uint32_t* openBits, int64_t position);
     void updateFFTSize();
+    void updateLatency();
+    void selectFFTConfiguration(int order, int hopSize);
+    void switchFFTConfiguration(int order, int hopSize, int numChannels, bool useKey, bool hopDelivered);
+    void pushHistory(int numChannels, bool useKey, int numSamples);
+    void readHistory(float* fifo, const float* history, int size) const;
+    void resetSTFT();
     int fftSizeToOrder(int size) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
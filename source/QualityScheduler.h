@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+//==============================================================================
+/* Picks how much STFT work an instance can afford, from the time its own
+ * processBlock calls take.
+ *
+ * The levels form a ladder below the configured FFT size. Level 0 is that
+ * size at 75% overlap, level 1 drops to 50% overlap, and every level after
+ * that halves the FFT size, still at 50% overlap, down to the smallest size.
+ * Each level costs strictly less per sample than the one above it.
+ *
+ * Every block's time as a fraction of its deadline goes into a moving
+ * average. The scheduler steps down when the average is over the budget, and
+ * steps up only when the cost model predicts the level above would stay under
+ * stepUpMargin of the budget, continuously for stepUpSeconds. Between the two
+ * it holds, and after every step it waits settleSeconds for the average to
+ * reflect the new level, so it can't oscillate on the boundary.
+ *
+ * It only decides. The processor moves to the new level at its next frame.
+ */
+class QualityScheduler
+{
+public:
+    // Averaging time of the block load
+    static constexpr double averagingSeconds = 0.1;
+
+    // Time after a step before the next decision, long enough for the average to settle
+    static constexpr double settleSeconds = 0.4;
+
+    // Headroom needed, as a fraction of the budget and for how long, before stepping up
+    static constexpr double stepUpMargin = 0.7;
+    static constexpr double stepUpSeconds = 2.0;
+
+    // One rung: FFT order and frames per FFT size, 4 for 75% overlap and 2 for 50%
+    struct Configuration
+    {
+        int order = 0;
+        int overlap = 4;
+
+        int getSize() const noexcept { return 1 << order; }
+        int getHopSize() const noexcept { return getSize() / overlap; }
+    };
+
+    static int getNumLevels (int ceilingOrder, int minOrder) noexcept { return 2 + ceilingOrder - minOrder; }
+
+    static Configuration getConfiguration (int ceilingOrder, int level) noexcept
+    {
+        if (level == 0)
+            return { ceilingOrder, 4 };
+
+        return { ceilingOrder - (level - 1), 2 };
+    }
+
+    // Per sample: overlap frames of N log N work spread over N samples
+    static double getRelativeCost (Configuration configuration) noexcept
+    {
+        return static_cast<double> (configuration.overlap * configuration.order);
+    }
+
+    // Back to level 0 with a new ladder length
+    void setNumLevels (int newNumLevels) noexcept
+    {
+        numLevels = std::max (1, newNumLevels);
+        reset();
+    }
+
+    // Back to level 0, forgetting the load history
+    void reset() noexcept
+    {
+        level = 0;
+        averageLoad = 0.0;
+        secondsSinceStep = 0.0;
+        secondsWithHeadroom = 0.0;
+    }
+
+    /* Adds one block that took elapsedSeconds of a blockSeconds deadline,
+     * against a budget given as a fraction of the deadline. Returns true when
+     * it changed the level.
+     */
+    bool addBlock (double elapsedSeconds, double blockSeconds, double budget, int ceilingOrder) noexcept
+    {
+        if (blockSeconds <= 0.0)
+            return false;
+
+        const double load = elapsedSeconds / blockSeconds;
+        averageLoad += (1.0 - std::exp (-blockSeconds / averagingSeconds)) * (load - averageLoad);
+        secondsSinceStep += blockSeconds;
+
+        if (secondsSinceStep < settleSeconds)
+            return false;
+
+        if (averageLoad > budget && level < numLevels - 1)
+            return step (level + 1);
+
+        if (level > 0)
+        {
+            const double costRatio = getRelativeCost (getConfiguration (ceilingOrder, level - 1))
+                                   / getRelativeCost (getConfiguration (ceilingOrder, level));
+
+            secondsWithHeadroom = averageLoad * costRatio < stepUpMargin * budget ? secondsWithHeadroom + blockSeconds : 0.0;
+
+            if (secondsWithHeadroom >= stepUpSeconds)
+                return step (level - 1);
+        }
+
+        return false;
+    }
+
+    int getLevel() const noexcept { return level; }
+    int getNumLevels() const noexcept { return numLevels; }
+
+    // Moving average of block time over deadline
+    double getAverageLoad() const noexcept { return averageLoad; }
+
+private:
+    bool step (int newLevel) noexcept
+    {
+        level = newLevel;
+        secondsSinceStep = 0.0;
+        secondsWithHeadroom = 0.0;
+        return true;
+    }
+
+    int numLevels = 1;
+    int level = 0;
+    double averageLoad = 0.0;
+    double secondsSinceStep = 0.0;
+    double secondsWithHeadroom = 0.0;
+};
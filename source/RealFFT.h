@@ -0,0 +1,125 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+//==============================================================================
+/* Real-to-complex FFT of N samples with an explicit Hermitian contract.
+ *
+ * forward() takes N real samples and writes bins 0..N/2, i.e. N/2 + 1 bins
+ * including DC and Nyquist, as split planes: real[k] and imag[k]. The
+ * transform is unscaled, X[k] = sum x[n] e^(-2 pi i k n / N), and imag[0] and
+ * imag[N/2] are always 0. The remaining bins are the conjugates of these and
+ * are never stored.
+ *
+ * inverse() takes the same N/2 + 1 bins and writes N real samples scaled by
+ * 1/N, so inverse (forward (x)) == x. imag[0] and imag[N/2] are ignored.
+ *
+ * Internally the even and odd samples are packed into one N/2-point complex
+ * FFT and separated with a twiddle pass, so the only scratch is N/2 complex
+ * values. The time-domain buffer is read as N/2 interleaved complex values, so
+ * it must not alias the spectrum planes.
+ */
+class RealFFT
+{
+public:
+    using Complex = std::complex<float>;
+
+    // order is log2 of the real size, at least 1
+    explicit RealFFT (int order)
+        : size (1 << order),
+          halfSize (size / 2),
+          complexFFT (order - 1),
+          scratch (static_cast<size_t> (halfSize)),
+          twiddleCos (static_cast<size_t> (halfSize + 1)),
+          twiddleSin (static_cast<size_t> (halfSize + 1))
+    {
+        jassert (order >= 1);
+
+        for (int k = 0; k <= halfSize; ++k)
+        {
+            const auto angle = 2.0 * juce::MathConstants<double>::pi * k / size;
+            twiddleCos[static_cast<size_t> (k)] = static_cast<float> (std::cos (angle));
+            twiddleSin[static_cast<size_t> (k)] = static_cast<float> (std::sin (angle));
+        }
+    }
+
+    int getSize() const noexcept { return size; }
+    int getNumBins() const noexcept { return halfSize + 1; }
+
+    void forward (const float* input, float* real, float* imag) noexcept
+    {
+        // z[n] = x[2n] + i x[2n + 1]
+        complexFFT.perform (reinterpret_cast<const Complex*> (input), scratch.data(), false);
+
+        const auto* z = scratch.data();
+        const auto* cosines = twiddleCos.data();
+        const auto* sines = twiddleSin.data();
+
+        // Both edges come from Z[0] alone: the even part is its real part, the odd part its imaginary part
+        real[0] = z[0].real() + z[0].imag();
+        imag[0] = 0.0f;
+        real[halfSize] = z[0].real() - z[0].imag();
+        imag[halfSize] = 0.0f;
+
+        // Even spectrum E = (Z[k] + conj Z[M-k]) / 2, odd O = (Z[k] - conj Z[M-k]) / 2i, X[k] = E + e^(-2 pi i k / N) O
+        for (int k = 1; k < halfSize; ++k)
+        {
+            const float zr = z[k].real();
+            const float zi = z[k].imag();
+            const float ar = z[halfSize - k].real();
+            const float ai = z[halfSize - k].imag();
+
+            const float evenReal = 0.5f * (zr + ar);
+            const float evenImag = 0.5f * (zi - ai);
+            const float oddReal = 0.5f * (zi + ai);
+            const float oddImag = 0.5f * (ar - zr);
+
+            real[k] = evenReal + cosines[k] * oddReal + sines[k] * oddImag;
+            imag[k] = evenImag + cosines[k] * oddImag - sines[k] * oddReal;
+        }
+    }
+
+    void inverse (const float* real, const float* imag, float* output) noexcept
+    {
+        auto* z = scratch.data();
+        const auto* cosines = twiddleCos.data();
+        const auto* sines = twiddleSin.data();
+
+        // The forward separation run backwards: E = (X[k] + conj X[M-k]) / 2, O = (X[k] - conj X[M-k]) e^(2 pi i k / N) / 2,
+        // Z[k] = E + i O. Bin M - k is always stored, so this needs no wrap. At k = 0 the imaginary parts are ignored.
+        z[0] = { 0.5f * (real[0] + real[halfSize]), 0.5f * (real[0] - real[halfSize]) };
+
+        for (int k = 1; k < halfSize; ++k)
+        {
+            const float xr = real[k];
+            const float xi = imag[k];
+            const float ar = real[halfSize - k];
+            const float ai = imag[halfSize - k];
+
+            const float evenReal = 0.5f * (xr + ar);
+            const float evenImag = 0.5f * (xi - ai);
+            const float diffReal = 0.5f * (xr - ar);
+            const float diffImag = 0.5f * (xi + ai);
+            const float oddReal = diffReal * cosines[k] - diffImag * sines[k];
+            const float oddImag = diffReal * sines[k] + diffImag * cosines[k];
+
+            z[k] = { evenReal - oddImag, evenImag + oddReal };
+        }
+
+        // juce::dsp::FFT scales its inverse by 1 / (N/2), which recovers z exactly and so gives the 1/N real inverse
+        complexFFT.perform (z, reinterpret_cast<Complex*> (output), true);
+    }
+
+private:
+    const int size;
+    const int halfSize;
+    juce::dsp::FFT complexFFT;
+
+    // Written by both directions, so one RealFFT is used by one thread at a time
+    std::vector<Complex> scratch;
+    std::vector<float> twiddleCos;
+    std::vector<float> twiddleSin;
+};
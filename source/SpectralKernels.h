@@ -0,0 +1,201 @@
+#pragma once
+
+#include "FastMath.h"
+#include <cstdint>
+
+//==============================================================================
+/* The STFT's hot loops: windowing, per-bin power and gains, the per-bin gate
+ * state carried across hops, overlap-add and the dry/wet mix.
+ *
+ * Each kernel is one flat, branch-free loop over contiguous arrays so that it
+ * vectorises. Spectra are the split real and imaginary planes written by
+ * RealFFT, N/2 + 1 bins from DC to Nyquist.
+ *
+ * The processor calls them through KernelDispatch.h, which picks the copy
+ * built for the best instruction set the CPU supports.
+ */
+namespace SpectralKernels
+{
+    struct ExpanderCurve
+    {
+        float thresholdDb = -30.0f;
+        float ratio = 4.0f;   // 1:ratio below the threshold
+        float kneeDb = 6.0f;  // width of the quadratic knee, centred on the threshold
+        float rangeDb = 40.0f; // maximum attenuation
+    };
+
+    // Per-hop smoothing of each bin's gain, see smoothGains
+    struct GainSmoothing
+    {
+        float attack = 0.0f;  // coefficient towards a higher gain, 0 jumps straight there
+        float release = 0.0f; // the same towards a lower gain, once the hold has run out
+        int holdHops = 0;     // hops a falling gain stays where it is first
+    };
+
+inline namespace SPECTRAL_GATE_KERNEL_ISA
+{
+    // Bin b's open state is bit b % 32 of word b / 32
+    constexpr int binsPerWord = 32;
+    constexpr int getNumStateWords (int numBins) noexcept { return (numBins + binsPerWord - 1) / binsPerWord; }
+    inline bool isBinOpen (const uint32_t* openBits, int bin) noexcept { return ((openBits[bin / binsPerWord] >> (bin % binsPerWord)) & 1u) != 0; }
+
+    // Rather than std::min and std::max, whose instantiations would sit outside this namespace,
+    // where the linker may keep this ISA's copy for every caller
+    inline float minOf (float a, float b) noexcept { return b < a ? b : a; }
+    inline float maxOf (float a, float b) noexcept { return a < b ? b : a; }
+    inline int32_t maxOf (int32_t a, int32_t b) noexcept { return a < b ? b : a; }
+
+    // frame *= window
+    inline void applyWindow (float* frame, const float* window, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            frame[i] *= window[i];
+    }
+
+    // |X|^2 per bin, the gate works on power so no square root is needed
+    inline void computePower (const float* real, const float* imag, float* power, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+            power[bin] = real[bin] * real[bin] + imag[bin] * imag[bin];
+    }
+
+    // Hard gate: bins below the threshold get belowGain, everything else passes
+    inline void gateGains (const float* power, float* gains, int numBins, float thresholdPower, float belowGain) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+            gains[bin] = power[bin] < thresholdPower ? belowGain : 1.0f;
+    }
+
+    /* Soft-knee downward expander, computed in the log domain:
+     *
+     *   over = level - threshold
+     *   gain = (ratio - 1) * over                           below the knee
+     *        = -(ratio - 1) * (over - knee/2)^2 / (2 knee)  inside it
+     *        = 0                                            above it
+     *
+     * limited to -range. The two pieces are written with clamps rather than
+     * branches: the linear term is (ratio - 1) * min (over + knee/2, 0).
+     */
+    inline void expanderGains (const float* power, float* gains, int numBins, const ExpanderCurve& curve) noexcept
+    {
+        constexpr float decibelsPerLog2Power = 3.01029996f; // 10 * log10 (2)
+        constexpr float log2PerDecibel = 0.166096405f;      // 1 / (20 * log10 (2))
+        constexpr float smallestPower = 1.0e-30f;
+
+        const float slope = curve.ratio - 1.0f;
+        const float halfKnee = 0.5f * maxOf (curve.kneeDb, 1.0e-3f);
+        const float kneeScale = slope / (4.0f * halfKnee);
+        const float floorDb = -curve.rangeDb;
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const float levelDb = decibelsPerLog2Power * FastMath::log2 (power[bin] + smallestPower);
+            const float over = levelDb - curve.thresholdDb;
+            const float inKnee = maxOf (minOf (over, halfKnee), -halfKnee) - halfKnee;
+            const float gainDb = slope * minOf (over + halfKnee, 0.0f) - kneeScale * inKnee * inKnee;
+            gains[bin] = FastMath::exp2 (maxOf (gainDb, floorDb) * log2PerDecibel);
+        }
+    }
+
+    /* Hysteresis: a bin that is open only closes below a lower threshold.
+     * Scaling an open bin's power by openBoost, the ratio between the two
+     * thresholds, before the gain kernels is the same thing, and works for
+     * the gate and the expander alike. The bits are unpacked 32 bins at a
+     * time so the inner loop has a fixed trip count and vectorises.
+     */
+    inline void hysteresisDetection (const float* power, float* detection, const uint32_t* openBits, int numBins, float openBoost) noexcept
+    {
+        const int numWholeWords = numBins / binsPerWord;
+
+        for (int word = 0; word < numWholeWords; ++word)
+        {
+            const uint32_t bits = openBits[word];
+            const float* wordPower = power + word * binsPerWord;
+            float* wordDetection = detection + word * binsPerWord;
+
+            for (int lane = 0; lane < binsPerWord; ++lane)
+                wordDetection[lane] = wordPower[lane] * (((bits >> lane) & 1u) != 0 ? openBoost : 1.0f);
+        }
+
+        for (int bin = numWholeWords * binsPerWord; bin < numBins; ++bin)
+            detection[bin] = power[bin] * (isBinOpen (openBits, bin) ? openBoost : 1.0f);
+    }
+
+    // A bin is open from the hop its (hysteresis) detection power reaches the threshold
+    inline void updateOpenBits (const float* detection, uint32_t* openBits, int numBins, float thresholdPower) noexcept
+    {
+        const int numWholeWords = numBins / binsPerWord;
+
+        for (int word = 0; word < numWholeWords; ++word)
+        {
+            const float* wordDetection = detection + word * binsPerWord;
+            uint32_t bits = 0;
+
+            for (int lane = 0; lane < binsPerWord; ++lane)
+                bits |= static_cast<uint32_t> (wordDetection[lane] >= thresholdPower) << lane;
+
+            openBits[word] = bits;
+        }
+
+        if (numWholeWords * binsPerWord < numBins)
+        {
+            uint32_t bits = 0;
+
+            for (int bin = numWholeWords * binsPerWord; bin < numBins; ++bin)
+                bits |= static_cast<uint32_t> (detection[bin] >= thresholdPower) << (bin % binsPerWord);
+
+            openBits[numWholeWords] = bits;
+        }
+    }
+
+    /* Attack, hold and release across hops. A gain at or above the bin's
+     * smoothed gain is approached with the attack coefficient and restarts
+     * the hold. A lower one leaves the smoothed gain where it is until the
+     * hold counter has run out, then is approached with the release one.
+     * gains holds the targets on the way in and the smoothed gains on the
+     * way out. Every choice is a select, so the loop stays branch-free.
+     */
+    inline void smoothGains (float* gains, float* smoothed, int32_t* holdCounters, int numBins, const GainSmoothing& smoothing) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const float target = gains[bin];
+            const float current = smoothed[bin];
+            const int32_t hold = holdCounters[bin];
+            const bool rising = target >= current;
+
+            const float coefficient = rising ? smoothing.attack : (hold > 0 ? 1.0f : smoothing.release);
+            const float next = target + coefficient * (current - target);
+
+            holdCounters[bin] = rising ? smoothing.holdHops : maxOf (hold - 1, 0);
+            smoothed[bin] = next;
+            gains[bin] = next;
+        }
+    }
+
+    inline void applyGains (float* real, float* imag, const float* gains, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            real[bin] *= gains[bin];
+            imag[bin] *= gains[bin];
+        }
+    }
+
+    // accumulator += frame * gain
+    inline void overlapAdd (float* accumulator, const float* frame, float gain, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            accumulator[i] += frame[i] * gain;
+    }
+
+    // wet = wet * wetGain + dry * (1 - wetGain)
+    inline void mixDryWet (float* wet, const float* dry, float wetGain, int numSamples) noexcept
+    {
+        const float dryGain = 1.0f - wetGain;
+
+        for (int i = 0; i < numSamples; ++i)
+            wet[i] = wet[i] * wetGain + dry[i] * dryGain;
+    }
+}
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "FastMath.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+//==============================================================================
+/* Single-producer / single-consumer ring of compact per-hop analysis frames.
+ *
+ * The audio thread writes one frame per FFT hop, the editor drains them on the
+ * message thread. Every slot is allocated up front so neither side ever touches
+ * the heap, and a full ring simply drops the newest frame instead of blocking.
+ *
+ * Each frame stores its magnitudes as 8-bit log levels (floorDecibels..0 dBFS)
+ * and the gate decision for every bin packed into 32-bit words.
+ */
+class SpectrogramFrameRing
+{
+public:
+    static constexpr float floorDecibels = -96.0f;
+
+    struct Frame
+    {
+        int numBins = 0;
+        int64_t position = 0;
+        int hopSize = 0;
+        const uint8_t* levels = nullptr;
+        const uint32_t* gateMask = nullptr;
+
+        bool isBinOpen (int bin) const noexcept { return ((gateMask[bin >> 5] >> (bin & 31)) & 1u) != 0; }
+    };
+
+    class FrameWriter
+    {
+    public:
+        FrameWriter() = default;
+
+        bool isValid() const noexcept { return levels != nullptr; }
+
+        // magnitude is expected to be normalised so that a full scale sine reads 1.0
+        void setBin (int bin, float magnitude, bool open) noexcept
+        {
+            setLevel (bin, quantiseLevel (magnitude), open);
+        }
+
+        // For writing one already quantised level to several rings
+        void setLevel (int bin, uint8_t level, bool open) noexcept
+        {
+            levels[bin] = level;
+            gateMask[bin >> 5] |= static_cast<uint32_t> (open) << (bin & 31);
+        }
+
+    private:
+        friend class SpectrogramFrameRing;
+        uint8_t* levels = nullptr;
+        uint32_t* gateMask = nullptr;
+    };
+
+    SpectrogramFrameRing (int capacityInFrames, int maxBinsPerFrame)
+        : fifo (capacityInFrames),
+          maxBins (maxBinsPerFrame),
+          maskWords ((maxBinsPerFrame + 31) / 32),
+          frameBins (static_cast<size_t> (capacityInFrames), 0),
+          framePositions (static_cast<size_t> (capacityInFrames), 0),
+          frameHops (static_cast<size_t> (capacityInFrames), 0),
+          levelStorage (static_cast<size_t> (capacityInFrames * maxBinsPerFrame), 0),
+          maskStorage (static_cast<size_t> (capacityInFrames * maskWords), 0)
+    {
+    }
+
+    int getMaxBins() const noexcept { return maxBins; }
+
+    // Set by the consumer so the audio thread can skip quantising when nobody is watching
+    void setConsumerActive (bool shouldBeActive) noexcept { consumerActive.store (shouldBeActive, std::memory_order_relaxed); }
+    bool isConsumerActive() const noexcept { return consumerActive.load (std::memory_order_relaxed); }
+
+    //==============================================================================
+    // Audio thread: returns an invalid writer when the ring is full
+    // position and hopSize are passed through to the consumer, e.g. the input sample the frame ends on
+    // and how far it is from the frame before, which changes with Auto quality
+    FrameWriter startFrame (int numBins, int64_t position = 0, int hopSize = 0) noexcept
+    {
+        FrameWriter writer;
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+        {
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+            return writer;
+        }
+
+        const int clampedBins = std::min (numBins, maxBins);
+        frameBins[static_cast<size_t> (start1)] = clampedBins;
+        framePositions[static_cast<size_t> (start1)] = position;
+        frameHops[static_cast<size_t> (start1)] = hopSize;
+        writer.levels = levelStorage.data() + start1 * maxBins;
+        writer.gateMask = maskStorage.data() + start1 * maskWords;
+        std::fill (writer.gateMask, writer.gateMask + (clampedBins + 31) / 32, 0u);
+        return writer;
+    }
+
+    void finishFrame (const FrameWriter& writer) noexcept
+    {
+        if (writer.isValid())
+            fifo.finishedWrite (1);
+    }
+
+    //==============================================================================
+    // Message thread
+    int getNumReady() const noexcept { return fifo.getNumReady(); }
+
+    // Frames the producer had to drop because the ring was full
+    int64_t getNumDropped() const noexcept { return numDropped.load (std::memory_order_relaxed); }
+
+    // Drops the oldest frames so that at most maxFramesToKeep remain
+    void discardAllBut (int maxFramesToKeep) noexcept
+    {
+        const int excess = fifo.getNumReady() - maxFramesToKeep;
+
+        if (excess > 0)
+            fifo.finishedRead (excess);
+    }
+
+    // Calls onFrame for up to maxFrames ready frames, oldest first, and returns how many were read
+    template <typename Callback>
+    int drain (int maxFrames, Callback&& onFrame)
+    {
+        const auto scope = fifo.read (std::min (maxFrames, fifo.getNumReady()));
+        scope.forEach ([&] (int index) {
+            onFrame (Frame { frameBins[static_cast<size_t> (index)],
+                framePositions[static_cast<size_t> (index)],
+                frameHops[static_cast<size_t> (index)],
+                levelStorage.data() + index * maxBins,
+                maskStorage.data() + index * maskWords });
+        });
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    //==============================================================================
+    static uint8_t quantiseLevel (float magnitude) noexcept
+    {
+        constexpr float decibelsPerOctave = 6.0206f;
+        constexpr float levelsPerDecibel = 255.0f / -floorDecibels;
+        const float decibels = decibelsPerOctave * FastMath::log2 (magnitude + 1.0e-9f);
+        const float level = (decibels - floorDecibels) * levelsPerDecibel;
+        return static_cast<uint8_t> (juce::jlimit (0.0f, 255.0f, level + 0.5f));
+    }
+
+private:
+    juce::AbstractFifo fifo;
+    const int maxBins;
+    const int maskWords;
+    std::atomic<bool> consumerActive { false };
+    std::atomic<int64_t> numDropped { 0 };
+
+    std::vector<int> frameBins;
+    std::vector<int64_t> framePositions;
+    std::vector<int> frameHops;
+    std::vector<uint8_t> levelStorage;
+    std::vector<uint32_t> maskStorage;
+
+    JUCE_DECLARE_NON_COPYABLE (SpectrogramFrameRing)
+};
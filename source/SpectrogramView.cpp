@@ -0,0 +1,132 @@
+#include "SpectrogramView.h"
+
+SpectrogramView::SpectrogramView (PluginProcessor& processorToWatch)
+    : processor (processorToWatch), ring (processorToWatch.getSpectrogramRing())
+{
+    juce::ColourGradient heat;
+    heat.addColour (0.0, juce::Colour (0xff1a1a1a));
+    heat.addColour (0.4, juce::Colour (0xff005000));
+    heat.addColour (0.75, juce::Colour (0xff00ff00));
+    heat.addColour (1.0, juce::Colour (0xffe0ffe0));
+
+    for (size_t level = 0; level < openPalette.size(); ++level)
+    {
+        const auto colour = heat.getColourAtPosition (static_cast<double> (level) / 255.0);
+        openPalette[level] = colour;
+        // Gated bins keep their brightness but are pulled towards red
+        gatedPalette[level] = colour.interpolatedWith (juce::Colour (0xffff0000), 0.45f).withMultipliedBrightness (0.6f);
+        // Bins outside the Low/High Limits are drawn in grey
+        bypassPalette[level] = juce::Colour::greyLevel (colour.getPerceivedBrightness()).withMultipliedBrightness (0.5f);
+    }
+
+    setOpaque (true);
+
+    // Anything queued while no editor was open is stale
+    ring.discardAllBut (0);
+    ring.setConsumerActive (true);
+    startTimerHz (30);
+}
+
+SpectrogramView::~SpectrogramView()
+{
+    ring.setConsumerActive (false);
+}
+
+void SpectrogramView::paint (juce::Graphics& g)
+{
+    if (history.isValid())
+        g.drawImageAt (history, 0, 0);
+    else
+        g.fillAll (juce::Colour (0xff1a1a1a));
+
+    g.setColour (juce::Colour (0xff606060));
+    g.drawRect (getLocalBounds(), 2);
+
+    g.setColour (juce::Colours::white);
+    g.setFont (12.0f);
+    g.drawText ("Spectrogram", getLocalBounds().removeFromTop (20), juce::Justification::centred);
+}
+
+void SpectrogramView::resized()
+{
+    // History is one pixel per hop and per row, so a new size starts a fresh image
+    if (getWidth() > 0 && getHeight() > 0)
+    {
+        history = juce::Image (juce::Image::RGB, getWidth(), getHeight(), false);
+        history.clear (history.getBounds(), juce::Colour (0xff1a1a1a));
+    }
+    else
+    {
+        history = {};
+    }
+
+    rowLookupBins = 0;
+}
+
+void SpectrogramView::timerCallback()
+{
+    if (! history.isValid())
+    {
+        ring.discardAllBut (0);
+        return;
+    }
+
+    const int width = history.getWidth();
+
+    // Frames that would scroll straight off the left edge are not worth drawing
+    ring.discardAllBut (width);
+    const int numNew = ring.getNumReady();
+
+    if (numNew == 0)
+        return;
+
+    if (numNew < width)
+        history.moveImageSection (0, 0, numNew, 0, width - numNew, history.getHeight());
+
+    juce::Image::BitmapData pixels (history, width - numNew, 0, numNew, history.getHeight(), juce::Image::BitmapData::writeOnly);
+    int column = 0;
+
+    ring.drain (numNew, [&] (const SpectrogramFrameRing::Frame& frame) {
+        drawColumn (pixels, column++, frame);
+    });
+
+    repaint();
+}
+
+void SpectrogramView::drawColumn (juce::Image::BitmapData& pixels, int x, const SpectrogramFrameRing::Frame& frame)
+{
+    if (frame.numBins <= 0)
+        return;
+
+    if (frame.numBins != rowLookupBins)
+        updateRowLookup (frame.numBins);
+
+    const auto activeBins = processor.getActiveBins (frame.numBins);
+
+    for (int y = 0; y < pixels.height; ++y)
+    {
+        const int bin = rowToBin[static_cast<size_t> (y)];
+        const auto level = frame.levels[bin];
+
+        if (! activeBins.contains (bin))
+            pixels.setPixelColour (x, y, bypassPalette[level]);
+        else
+            pixels.setPixelColour (x, y, frame.isBinOpen (bin) ? openPalette[level] : gatedPalette[level]);
+    }
+}
+
+void SpectrogramView::updateRowLookup (int numBins)
+{
+    const int height = history.getHeight();
+    rowToBin.resize (static_cast<size_t> (height));
+
+    // Linear frequency axis like SpectrumAnalyzer, DC at the bottom row
+    for (int y = 0; y < height; ++y)
+    {
+        const int fromBottom = height - 1 - y;
+        const int bin = (fromBottom * numBins) / height;
+        rowToBin[static_cast<size_t> (y)] = juce::jlimit (0, numBins - 1, bin);
+    }
+
+    rowLookupBins = numBins;
+}
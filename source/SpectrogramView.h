@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PluginProcessor.h"
+
+//==============================================================================
+/* Scrolling spectrogram of the gate's recent history.
+ *
+ * Frames are drained from the processor's SpectrogramFrameRing on a timer.
+ * The history lives in an image with one column per hop: new frames scroll the
+ * image left and only the new columns are drawn, so the cost per tick depends
+ * on how many hops arrived rather than on the size of the view.
+ */
+class SpectrogramView : public juce::Component, private juce::Timer
+{
+public:
+    explicit SpectrogramView (PluginProcessor& processor);
+    ~SpectrogramView() override;
+
+    void paint (juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void drawColumn (juce::Image::BitmapData& pixels, int x, const SpectrogramFrameRing::Frame& frame);
+    void updateRowLookup (int numBins);
+
+    PluginProcessor& processor;
+    SpectrogramFrameRing& ring;
+
+    juce::Image history;
+
+    // Which bin each image row shows, row 0 being the top (highest frequency)
+    std::vector<int> rowToBin;
+    int rowLookupBins = 0;
+
+    // 256 entry colour tables indexed by the quantised level
+    std::array<juce::Colour, 256> openPalette;
+    std::array<juce::Colour, 256> gatedPalette;
+    std::array<juce::Colour, 256> bypassPalette;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrogramView)
+};
@@ -0,0 +1,187 @@
+#include "StageTracer.h"
+
+std::atomic<StageTracer*> StageTracer::activeTracer { nullptr };
+std::array<StageTracer::RecordingSlot, StageTracer::maxRecordingThreads> StageTracer::recordingSlots;
+std::atomic<int> StageTracer::numSlotsClaimed { 0 };
+std::atomic<uint32_t> StageTracer::nextTracerId { 1 };
+
+StageTracer::StageTracer (const juce::File& file, int eventsPerThread, int maxThreads)
+    : juce::Thread ("Stage trace writer"),
+      outputFile (file),
+      tracerId (nextTracerId.fetch_add (1)),
+      originTicks (juce::Time::getHighResolutionTicks())
+{
+    // Every ring is allocated here so claiming one from the audio thread is just an atomic increment
+    rings.reserve (static_cast<size_t> (maxThreads));
+    for (int i = 0; i < maxThreads; ++i)
+        rings.push_back (std::make_unique<ThreadRing> (eventsPerThread));
+}
+
+StageTracer::~StageTracer()
+{
+    auto* self = this;
+    activeTracer.compare_exchange_strong (self, nullptr, std::memory_order_seq_cst);
+
+    // A recording thread may have loaded the pointer just before it was cleared. Its slot store and
+    // this load are both seq_cst, so either it sees the pointer cleared or this sees its slot.
+    const int numSlots = juce::jmin (numSlotsClaimed.load (std::memory_order_seq_cst), maxRecordingThreads);
+
+    for (int index = 0; index < numSlots; ++index)
+        while (recordingSlots[static_cast<size_t> (index)].tracer.load (std::memory_order_seq_cst) == this)
+            juce::Thread::yield();
+
+    stopThread (2000);
+
+    if (stream != nullptr)
+    {
+        drainToFile();
+        stream->writeText ("\n]}\n", false, false, nullptr);
+        stream->flush();
+    }
+}
+
+bool StageTracer::start()
+{
+    if (stream == nullptr)
+    {
+        outputFile.deleteFile();
+        stream = std::make_unique<juce::FileOutputStream> (outputFile);
+
+        if (stream->failedToOpen())
+        {
+            stream.reset();
+            return false;
+        }
+
+        stream->writeText ("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", false, false, nullptr);
+    }
+
+    StageTracer* expected = nullptr;
+    if (! activeTracer.compare_exchange_strong (expected, this))
+        return expected == this;
+
+    startThread();
+    return true;
+}
+
+//==============================================================================
+void StageTracer::record (const char* name, int64_t startTicks, int64_t endTicks) noexcept
+{
+    auto* slot = getSlotForThisThread();
+    auto* tracer = activeTracer.load (std::memory_order_seq_cst);
+
+    if (slot == nullptr || tracer == nullptr)
+        return;
+
+    // Publish before checking the tracer is still installed, the other half of the destructor's handshake
+    slot->tracer.store (tracer, std::memory_order_seq_cst);
+
+    if (activeTracer.load (std::memory_order_seq_cst) == tracer)
+    {
+        if (auto* ring = tracer->getRingForThisThread())
+        {
+            int start1, size1, start2, size2;
+            ring->fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+            if (size1 > 0)
+            {
+                ring->events[static_cast<size_t> (start1)] = { name, startTicks, endTicks };
+                ring->fifo.finishedWrite (1);
+            }
+            else
+            {
+                tracer->numDropped.fetch_add (1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            tracer->numDropped.fetch_add (1, std::memory_order_relaxed);
+        }
+    }
+
+    slot->tracer.store (nullptr, std::memory_order_release);
+}
+
+StageTracer::RecordingSlot* StageTracer::getSlotForThisThread() noexcept
+{
+    // Claimed on a thread's first event, only then touching the shared count
+    thread_local RecordingSlot* slot = [] {
+        const int index = numSlotsClaimed.fetch_add (1, std::memory_order_seq_cst);
+        return index < maxRecordingThreads ? &recordingSlots[static_cast<size_t> (index)] : nullptr;
+    }();
+
+    return slot;
+}
+
+StageTracer::ThreadRing* StageTracer::getRingForThisThread() noexcept
+{
+    // Tracer ids rather than pointers, so a new tracer at a recycled address isn't mistaken for the old one
+    thread_local uint32_t ownerId = 0;
+    thread_local ThreadRing* ring = nullptr;
+
+    if (ownerId != tracerId)
+    {
+        const int index = numRingsClaimed.fetch_add (1);
+        ring = index < static_cast<int> (rings.size()) ? rings[static_cast<size_t> (index)].get() : nullptr;
+        ownerId = tracerId;
+    }
+
+    return ring;
+}
+
+//==============================================================================
+void StageTracer::run()
+{
+    while (! threadShouldExit())
+    {
+        drainToFile();
+        wait (50);
+    }
+}
+
+void StageTracer::drainToFile()
+{
+    const double microsecondsPerTick = 1.0e6 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+    const int numRings = juce::jmin (numRingsClaimed.load(), static_cast<int> (rings.size()));
+
+    for (int index = 0; index < numRings; ++index)
+    {
+        auto& ring = *rings[static_cast<size_t> (index)];
+        const auto scope = ring.fifo.read (ring.fifo.getNumReady());
+
+        scope.forEach ([&] (int eventIndex) {
+            const auto& event = ring.events[static_cast<size_t> (eventIndex)];
+            const auto startMicros = static_cast<double> (event.startTicks - originTicks) * microsecondsPerTick;
+            const auto durationMicros = static_cast<double> (event.endTicks - event.startTicks) * microsecondsPerTick;
+
+            juce::String line;
+            line << (firstEventWritten ? ",\n" : "")
+                 << "{\"name\":\"" << event.name << "\",\"cat\":\"dsp\",\"ph\":\"X\""
+                 << ",\"ts\":" << juce::String (startMicros, 3)
+                 << ",\"dur\":" << juce::String (durationMicros, 3)
+                 << ",\"pid\":1,\"tid\":" << (index + 1) << "}";
+
+            stream->writeText (line, false, false, nullptr);
+            firstEventWritten = true;
+        });
+    }
+
+    stream->flush();
+}
+
+//==============================================================================
+#if SPECTRAL_GATE_TRACING
+SharedStageTracer::SharedStageTracer()
+{
+    const auto path = juce::SystemStats::getEnvironmentVariable ("SPECTRAL_GATE_TRACE_FILE", {});
+
+    if (path.isEmpty())
+        return;
+
+    tracer = std::make_unique<StageTracer> (juce::File (path));
+
+    // Another tracer (e.g. one a test installed) already owns the sink
+    if (! tracer->start())
+        tracer.reset();
+}
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#ifndef SPECTRAL_GATE_TRACING
+    #define SPECTRAL_GATE_TRACING 0
+#endif
+
+//==============================================================================
+/* Records how long each stage of the STFT pipeline takes and streams the result
+ * to a Chrome trace-event JSON file (open it in chrome://tracing or Perfetto).
+ *
+ * Each recording thread claims one of a fixed number of preallocated SPSC
+ * event rings, so recording never allocates or locks. A background thread
+ * drains the rings and appends complete ("X") events to the file.
+ *
+ * While a thread records, it publishes the tracer in a slot of its own (a
+ * hazard pointer), which the destructor waits to see cleared. Every slot has
+ * its own cache line, so threads recording at once don't share one.
+ *
+ * Only one tracer can be active at a time. Stages are marked with
+ * SG_TRACE_SCOPE, which compiles to nothing unless SPECTRAL_GATE_TRACING is set.
+ */
+class StageTracer : private juce::Thread
+{
+public:
+    explicit StageTracer (const juce::File& outputFile, int eventsPerThread = 1 << 14, int maxThreads = 16);
+
+    // Uninstalls the tracer, flushes what's left and closes the JSON
+    ~StageTracer() override;
+
+    // Makes this the active tracer and starts the writer thread. Fails if another tracer is active.
+    bool start();
+
+    const juce::File& getOutputFile() const noexcept { return outputFile; }
+
+    // Events lost because a thread's ring was full or no ring was left for it
+    int64_t getNumDroppedEvents() const noexcept { return numDropped.load (std::memory_order_relaxed); }
+
+    //==============================================================================
+    static bool isActive() noexcept { return activeTracer.load (std::memory_order_relaxed) != nullptr; }
+
+    // name must be a string literal (or otherwise outlive the tracer)
+    static void record (const char* name, int64_t startTicks, int64_t endTicks) noexcept;
+
+    class Scope
+    {
+    public:
+        explicit Scope (const char* stageName) noexcept
+            : name (stageName), startTicks (isActive() ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~Scope() noexcept
+        {
+            if (startTicks != 0)
+                record (name, startTicks, juce::Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char* name;
+        const int64_t startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+private:
+    struct Event
+    {
+        const char* name;
+        int64_t startTicks;
+        int64_t endTicks;
+    };
+
+    // The tracer one thread is recording into, if any
+    struct alignas (64) RecordingSlot
+    {
+        std::atomic<StageTracer*> tracer { nullptr };
+    };
+
+    // Threads past this many never record, slots aren't handed back when a thread ends
+    static constexpr int maxRecordingThreads = 256;
+
+    struct ThreadRing
+    {
+        explicit ThreadRing (int capacity) : fifo (capacity), events (static_cast<size_t> (capacity)) {}
+
+        juce::AbstractFifo fifo;
+        std::vector<Event> events;
+    };
+
+    void run() override;
+    void drainToFile();
+    ThreadRing* getRingForThisThread() noexcept;
+    static RecordingSlot* getSlotForThisThread() noexcept;
+
+    const juce::File outputFile;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    bool firstEventWritten = false;
+
+    const uint32_t tracerId;
+    const int64_t originTicks;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::atomic<int> numRingsClaimed { 0 };
+    std::atomic<int64_t> numDropped { 0 };
+
+    static std::atomic<StageTracer*> activeTracer;
+    static std::array<RecordingSlot, maxRecordingThreads> recordingSlots;
+    static std::atomic<int> numSlotsClaimed;
+    static std::atomic<uint32_t> nextTracerId;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageTracer)
+};
+
+//==============================================================================
+#if SPECTRAL_GATE_TRACING
+/* Process-wide tracer shared by every processor via juce::SharedResourcePointer.
+ * Only records when $SPECTRAL_GATE_TRACE_FILE names the file to write to.
+ */
+struct SharedStageTracer
+{
+    SharedStageTracer();
+    std::unique_ptr<StageTracer> tracer;
+};
+
+    #define SG_TRACE_SCOPE(stageName) const StageTracer::Scope JUCE_JOIN_MACRO (traceScope_, __LINE__) (stageName)
+#else
+    #define SG_TRACE_SCOPE(stageName)
+#endif
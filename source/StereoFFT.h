@@ -0,0 +1,109 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <complex>
+#include <vector>
+
+//==============================================================================
+/* Two real channels of N samples through one N-point complex FFT.
+ *
+ * forward() packs left into the real part and right into the imaginary part,
+ * z[n] = l[n] + i r[n], transforms once, and separates the two spectra with
+ * conjugate symmetry:
+ *
+ *   L[k] = (Z[k] + conj Z[N-k]) / 2
+ *   R[k] = (Z[k] - conj Z[N-k]) / 2i
+ *
+ * It writes the same N/2 + 1 split-plane bins per channel as RealFFT, with
+ * the same unscaled convention, so the mask kernels can't tell them apart.
+ *
+ * inverse() rebuilds the full spectrum Y[k] = L[k] + i R[k] from both
+ * channels' (possibly gated) bins, runs one inverse complex FFT and unpacks
+ * the real and imaginary parts, scaled by 1/N like RealFFT::inverse. The
+ * imaginary parts of DC and Nyquist are ignored.
+ *
+ * Per stereo frame that is one complex FFT each way instead of two RealFFTs,
+ * and one separation pass instead of two twiddle passes.
+ */
+class StereoFFT
+{
+public:
+    using Complex = std::complex<float>;
+
+    // order is log2 of the size, at least 1
+    explicit StereoFFT (int order)
+        : size (1 << order),
+          complexFFT (order),
+          packed (static_cast<size_t> (size)),
+          spectrum (static_cast<size_t> (size))
+    {
+        jassert (order >= 1);
+    }
+
+    int getSize() const noexcept { return size; }
+    int getNumBins() const noexcept { return size / 2 + 1; }
+
+    void forward (const float* left, const float* right,
+                  float* leftReal, float* leftImag, float* rightReal, float* rightImag) noexcept
+    {
+        auto* z = packed.data();
+
+        for (int n = 0; n < size; ++n)
+            z[n] = { left[n], right[n] };
+
+        complexFFT.perform (z, spectrum.data(), false);
+
+        const auto* bins = spectrum.data();
+        const int mask = size - 1;
+
+        // Bin N - k wraps to 0 at k = 0, where both channels are purely real
+        for (int k = 0; k <= size / 2; ++k)
+        {
+            const float zr = bins[k].real();
+            const float zi = bins[k].imag();
+            const float ar = bins[(size - k) & mask].real();
+            const float ai = bins[(size - k) & mask].imag();
+
+            leftReal[k] = 0.5f * (zr + ar);
+            leftImag[k] = 0.5f * (zi - ai);
+            rightReal[k] = 0.5f * (zi + ai);
+            rightImag[k] = 0.5f * (ar - zr);
+        }
+    }
+
+    void inverse (const float* leftReal, const float* leftImag, const float* rightReal, const float* rightImag,
+                  float* left, float* right) noexcept
+    {
+        auto* bins = spectrum.data();
+        const int halfSize = size / 2;
+
+        bins[0] = { leftReal[0], rightReal[0] };
+        bins[halfSize] = { leftReal[halfSize], rightReal[halfSize] };
+
+        // Y[k] = L[k] + i R[k], and Y[N-k] = conj L[k] + i conj R[k] for the bins that aren't stored
+        for (int k = 1; k < halfSize; ++k)
+        {
+            bins[k] = { leftReal[k] - rightImag[k], leftImag[k] + rightReal[k] };
+            bins[size - k] = { leftReal[k] + rightImag[k], rightReal[k] - leftImag[k] };
+        }
+
+        // juce::dsp::FFT scales its inverse by 1/N
+        complexFFT.perform (bins, packed.data(), true);
+
+        const auto* z = packed.data();
+
+        for (int n = 0; n < size; ++n)
+        {
+            left[n] = z[n].real();
+            right[n] = z[n].imag();
+        }
+    }
+
+private:
+    const int size;
+    juce::dsp::FFT complexFFT;
+
+    // Written by both directions, so one StereoFFT is used by one thread at a time
+    std::vector<Complex> packed;
+    std::vector<Complex> spectrum;
+};
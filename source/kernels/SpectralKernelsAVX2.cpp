@@ -0,0 +1,7 @@
+// Built with AVX2 and FMA, selected when the CPU has both (see KernelDispatch.h)
+#define SPECTRAL_GATE_KERNEL_ISA avx2
+#include "../KernelDispatch.h"
+
+#if SPECTRAL_GATE_KERNELS_X86
+const SpectralKernels::KernelTable SpectralKernels::avx2Kernels = SPECTRAL_GATE_KERNEL_TABLE ("AVX2");
+#endif
@@ -0,0 +1,7 @@
+// Built with AVX-512F, selected when the CPU has it (see KernelDispatch.h)
+#define SPECTRAL_GATE_KERNEL_ISA avx512
+#include "../KernelDispatch.h"
+
+#if SPECTRAL_GATE_KERNELS_X86
+const SpectralKernels::KernelTable SpectralKernels::avx512Kernels = SPECTRAL_GATE_KERNEL_TABLE ("AVX-512");
+#endif
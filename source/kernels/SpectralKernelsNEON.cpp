@@ -0,0 +1,7 @@
+// Baseline on arm64, only needs -mfpu=neon on 32-bit ARM (see KernelDispatch.h)
+#define SPECTRAL_GATE_KERNEL_ISA neon
+#include "../KernelDispatch.h"
+
+#if SPECTRAL_GATE_KERNELS_NEON
+const SpectralKernels::KernelTable SpectralKernels::neonKernels = SPECTRAL_GATE_KERNEL_TABLE ("NEON");
+#endif
@@ -0,0 +1,7 @@
+// Baseline on x86-64, only needs -msse2 on 32-bit x86 (see KernelDispatch.h)
+#define SPECTRAL_GATE_KERNEL_ISA sse2
+#include "../KernelDispatch.h"
+
+#if SPECTRAL_GATE_KERNELS_X86
+const SpectralKernels::KernelTable SpectralKernels::sse2Kernels = SPECTRAL_GATE_KERNEL_TABLE ("SSE2");
+#endif
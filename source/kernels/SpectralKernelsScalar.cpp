@@ -0,0 +1,5 @@
+// Built with auto-vectorisation turned off: the reference the SIMD variants are tested against (see KernelDispatch.h)
+#define SPECTRAL_GATE_KERNEL_ISA scalar
+#include "../KernelDispatch.h"
+
+const SpectralKernels::KernelTable SpectralKernels::scalarKernels = SPECTRAL_GATE_KERNEL_TABLE ("Scalar");
@@ -0,0 +1,115 @@
+#include "helpers/test_helpers.h"
+#include <AnalysisCapture.h>
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    struct TempCaptureFile
+    {
+        ~TempCaptureFile() { file.deleteFile(); }
+        const juce::File file = juce::File::createTempFile (".sgcap");
+    };
+}
+
+TEST_CASE ("Capture files round trip through the reader", "[capture]")
+{
+    TempCaptureFile temp;
+    SpectrogramFrameRing ring (64, 100);
+    constexpr int numFrames = 5000;  // more than the initial capacity, so the file has to grow
+
+    {
+        AnalysisCapture::Format format;
+        format.fftSize = 198;
+        format.hopSize = 49;
+        format.sampleRate = 48000.0;
+
+        AnalysisCaptureWriter writer (ring, temp.file, format);
+        REQUIRE (writer.start());
+        REQUIRE (ring.isConsumerActive());
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            // Act as the audio thread: wait for room rather than dropping
+            SpectrogramFrameRing::FrameWriter frameWriter;
+            while (! (frameWriter = ring.startFrame (99, frame * 49, 49)).isValid())
+                juce::Thread::sleep (1);
+
+            for (int bin = 0; bin < 99; ++bin)
+                frameWriter.setLevel (bin, static_cast<uint8_t> ((frame + bin) & 0xff), (frame + bin) % 3 == 0);
+
+            ring.finishFrame (frameWriter);
+        }
+    }
+
+    REQUIRE_FALSE (ring.isConsumerActive());
+
+    // Trimmed to exactly the frames written
+    REQUIRE (temp.file.getSize() == static_cast<int64_t> (sizeof (AnalysisCapture::FileHeader)) + numFrames * AnalysisCapture::getFrameBytes (100));
+
+    AnalysisCaptureReader reader (temp.file);
+    REQUIRE (reader.isValid());
+    REQUIRE (reader.getNumFrames() == numFrames);
+    REQUIRE (reader.getHeader().fftSize == 198);
+    REQUIRE (reader.getHeader().hopSize == 49);
+    REQUIRE (reader.getHeader().sampleRate == 48000.0);
+    REQUIRE (reader.getHeader().maxBins == 100);
+    REQUIRE (reader.getHeader().numDropped == 0);
+
+    for (const int index : { 0, 1, 2047, 4999 })
+    {
+        const auto frame = reader.getFrame (index);
+        REQUIRE (frame.numBins == 99);
+        REQUIRE (frame.position == index * 49);
+        REQUIRE (frame.hopSize == 49);
+
+        for (int bin = 0; bin < 99; ++bin)
+        {
+            REQUIRE (frame.levels[bin] == static_cast<uint8_t> ((index + bin) & 0xff));
+            REQUIRE (frame.isBinOpen (bin) == ((index + bin) % 3 == 0));
+        }
+    }
+}
+
+TEST_CASE ("Capture reader rejects files that aren't captures", "[capture]")
+{
+    TempCaptureFile temp;
+    temp.file.replaceWithText ("definitely not a capture, but long enough to hold a header if it were one");
+
+    REQUIRE_FALSE (AnalysisCaptureReader (temp.file).isValid());
+    REQUIRE_FALSE (AnalysisCaptureReader (temp.file.getSiblingFile ("missing.sgcap")).isValid());
+}
+
+TEST_CASE ("Processor captures every hop while capture is on", "[capture]")
+{
+    TempCaptureFile temp;
+    PluginProcessor plugin;
+    plugin.setPlayConfigDetails (1, 1, 48000.0, 512);
+    plugin.prepareToPlay (48000.0, 512);
+
+    juce::AudioBuffer<float> buffer (1, 512);
+    juce::Random random (3);
+
+    REQUIRE (plugin.startCapture (temp.file));
+    REQUIRE (plugin.isCapturing());
+
+    // Mono and slow enough that the writer keeps up, so no frame is dropped
+    processBlocks (
+        plugin, buffer, 40,
+        [&] (juce::AudioBuffer<float>& input, int) { fillWithNoise (input, random, 0.5f); },
+        [] (const juce::AudioBuffer<float>&, int) { juce::Thread::sleep (2); });
+
+    plugin.stopCapture();
+    REQUIRE_FALSE (plugin.isCapturing());
+
+    AnalysisCaptureReader reader (temp.file);
+    REQUIRE (reader.isValid());
+    REQUIRE (reader.getHeader().fftSize == 1024);
+    REQUIRE (reader.getHeader().sampleRate == 48000.0);
+
+    // 40 * 512 samples with a 1024 FFT and 256 hop
+    REQUIRE (reader.getNumFrames() == (40 * 512 - 1024) / 256 + 1);
+    REQUIRE (reader.getFrame (0).position == 1024);
+    REQUIRE (reader.getFrame (1).position == 1024 + 256);
+    REQUIRE (reader.getFrame (1).hopSize == 256);
+}
@@ -0,0 +1,147 @@
+#include "helpers/test_helpers.h"
+#include <AnalysisDecimator.h>
+#include <PluginProcessor.h>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+namespace
+{
+    // RMS of a decimated round trip once the filters have settled, plus the error against the delayed input
+    struct ToneResult
+    {
+        double outputRms = 0.0;
+        double errorRms = 0.0;
+    };
+
+    ToneResult roundTripTone (AnalysisDecimator& decimator, double frequency, double sampleRate)
+    {
+        decimator.reset();
+        const int latency = decimator.getLatencySamples();
+        const int numSamples = 20000;
+        const int settle = 2000;
+        ToneResult result;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto phase = 2.0 * juce::MathConstants<double>::pi * frequency / sampleRate;
+            decimator.pushInput (0, static_cast<float> (std::sin (phase * n)));
+
+            if (decimator.isLowRateStep())
+                decimator.pushLowRateOutput (0, decimator.getLowRateSample (0));
+
+            const auto output = decimator.interpolate (0);
+            decimator.advance();
+
+            if (n >= settle)
+            {
+                const auto error = output - std::sin (phase * (n - latency));
+                result.outputRms += output * output;
+                result.errorRms += error * error;
+            }
+        }
+
+        result.outputRms = std::sqrt (result.outputRms / (numSamples - settle));
+        result.errorRms = std::sqrt (result.errorRms / (numSamples - settle));
+        return result;
+    }
+}
+
+TEST_CASE ("Decimation factor keeps the analysis rate at 44.1 kHz or above", "[decimator]")
+{
+    REQUIRE (AnalysisDecimator::factorForSampleRate (44100.0) == 1);
+    REQUIRE (AnalysisDecimator::factorForSampleRate (48000.0) == 1);
+    REQUIRE (AnalysisDecimator::factorForSampleRate (96000.0) == 2);
+    REQUIRE (AnalysisDecimator::factorForSampleRate (192000.0) == 4);
+    REQUIRE (AnalysisDecimator::factorForSampleRate (384000.0) == 8);
+}
+
+TEST_CASE ("Decimated round trip passes the audio band and removes the rest", "[decimator]")
+{
+    AnalysisDecimator decimator;
+    decimator.prepare (1);
+    decimator.setFactor (4);
+
+    // 192 kHz down to 48 kHz
+    for (double frequency : { 100.0, 1000.0, 10000.0, 20000.0 })
+    {
+        const auto result = roundTripTone (decimator, frequency, 192000.0);
+        INFO ("frequency " << frequency);
+        CHECK (result.errorRms < 1.0e-3);
+    }
+
+    for (double frequency : { 30000.0, 60000.0 })
+    {
+        const auto result = roundTripTone (decimator, frequency, 192000.0);
+        INFO ("frequency " << frequency);
+        CHECK (result.outputRms < 1.0e-3);
+    }
+}
+
+TEST_CASE ("Window time mode picks the FFT size from the sample rate", "[decimator]")
+{
+    PluginProcessor plugin;
+    setParameter (plugin, "resolution", 1.0f);
+    setParameter (plugin, "windowtime", 21.3f);
+
+    SECTION ("full rate analysis scales the FFT with the sample rate")
+    {
+        plugin.prepareToPlay (48000.0, 512);
+        REQUIRE (plugin.getFFTSize() == 1024);
+
+        plugin.prepareToPlay (96000.0, 512);
+        REQUIRE (plugin.getFFTSize() == 2048);
+        REQUIRE (plugin.getDecimationFactor() == 1);
+    }
+
+    SECTION ("decimated analysis keeps 192 kHz at the 48 kHz cost")
+    {
+        setParameter (plugin, "analysisrate", 1.0f);
+        plugin.prepareToPlay (192000.0, 512);
+        REQUIRE (plugin.getDecimationFactor() == 4);
+        REQUIRE (plugin.getAnalysisSampleRate() == 48000.0);
+        REQUIRE (plugin.getFFTSize() == 1024);
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        processBlocks (plugin, buffer, 20, [] (juce::AudioBuffer<float>& input, int block) {
+            for (int channel = 0; channel < 2; ++channel)
+                for (int sample = 0; sample < 512; ++sample)
+                    input.setSample (channel, sample, 0.5f * std::sin (0.01f * static_cast<float> (block * 512 + sample)));
+        });
+
+        for (int channel = 0; channel < 2; ++channel)
+            for (int sample = 0; sample < 512; ++sample)
+                REQUIRE (std::isfinite (buffer.getSample (channel, sample)));
+    }
+
+    SECTION ("fixed size mode ignores the sample rate")
+    {
+        setParameter (plugin, "resolution", 0.0f);
+        plugin.prepareToPlay (192000.0, 512);
+        REQUIRE (plugin.getFFTSize() == 1024);
+    }
+}
+
+TEST_CASE ("Reported latency matches the delay through a decimated STFT", "[decimator]")
+{
+    constexpr int blockSize = 512;
+    std::vector<float> impulse (24 * blockSize, 0.0f);
+    constexpr int impulsePosition = 3001;
+    impulse[impulsePosition] = 1.0f;
+
+    // Mono, open gate, so the lowpass, STFT and interpolator only delay the input
+    PluginProcessor plugin;
+    setParameter (plugin, "analysisrate", 1.0f);
+    setParameter (plugin, "balance", 1.0f);
+    plugin.setPlayConfigDetails (1, 1, 192000.0, blockSize);
+    plugin.prepareToPlay (192000.0, blockSize);
+
+    REQUIRE (plugin.getDecimationFactor() == 4);
+
+    // The FFT size at the analysis rate, plus the lowpass and interpolator
+    REQUIRE (plugin.getLatencySamples() > 1024 * 4);
+
+    const auto output = processChannels (plugin, { impulse }, blockSize)[0];
+    const auto peak = std::max_element (output.begin(), output.end()) - output.begin();
+    REQUIRE (peak == impulsePosition + plugin.getLatencySamples());
+}
@@ -0,0 +1,150 @@
+#include "helpers/test_helpers.h"
+#include <BinGateState.h>
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+namespace
+{
+    // One hop of the state engine for a single bin, as computeMask runs it for a hard gate
+    float gateHop (BinGateState& state, float power, float thresholdPower, float openBoost, const SpectralKernels::GainSmoothing& smoothing)
+    {
+        float detection = 0.0f, gain = 0.0f;
+        SpectralKernels::hysteresisDetection (&power, &detection, state.openBits.data(), 1, openBoost);
+        SpectralKernels::gateGains (&detection, &gain, 1, thresholdPower, 0.0f);
+        SpectralKernels::updateOpenBits (&detection, state.openBits.data(), 1, thresholdPower);
+        SpectralKernels::smoothGains (&gain, state.gains.data(), state.holdCounters.data(), 1, smoothing);
+        return gain;
+    }
+}
+
+TEST_CASE ("Open bits pack 32 bins to a word", "[binstate]")
+{
+    // Every other bin open, across a whole word and a partial one
+    constexpr int numBins = 45;
+    std::vector<float> power (numBins);
+    for (int bin = 0; bin < numBins; ++bin)
+        power[(size_t) bin] = bin % 2 == 0 ? 2.0f : 0.5f;
+
+    BinGateState state;
+    state.allocate (numBins);
+    REQUIRE (state.openBits.size() == 2);
+
+    SpectralKernels::updateOpenBits (power.data(), state.openBits.data(), numBins, 1.0f);
+    REQUIRE (state.openBits[0] == 0x55555555u);
+    REQUIRE (state.openBits[1] == 0x1555u);
+
+    for (int bin = 0; bin < numBins; ++bin)
+        REQUIRE (SpectralKernels::isBinOpen (state.openBits.data(), bin) == (bin % 2 == 0));
+}
+
+TEST_CASE ("Hysteresis keeps a bin open until it falls below the closing threshold", "[binstate]")
+{
+    // Opens at 1, closes below 1/4 (6 dB of hysteresis)
+    BinGateState state;
+    state.allocate (1);
+    const SpectralKernels::GainSmoothing none;
+
+    REQUIRE (gateHop (state, 0.5f, 1.0f, 4.0f, none) == 0.0f);
+    REQUIRE (gateHop (state, 1.2f, 1.0f, 4.0f, none) == 1.0f);
+    REQUIRE (gateHop (state, 0.5f, 1.0f, 4.0f, none) == 1.0f);
+    REQUIRE (gateHop (state, 0.3f, 1.0f, 4.0f, none) == 1.0f);
+    REQUIRE (gateHop (state, 0.2f, 1.0f, 4.0f, none) == 0.0f);
+    REQUIRE (gateHop (state, 0.5f, 1.0f, 4.0f, none) == 0.0f);
+
+    // Without hysteresis the same powers chatter
+    state.reset();
+    REQUIRE (gateHop (state, 1.2f, 1.0f, 1.0f, none) == 1.0f);
+    REQUIRE (gateHop (state, 0.5f, 1.0f, 1.0f, none) == 0.0f);
+}
+
+TEST_CASE ("Gains attack, hold and then release across hops", "[binstate]")
+{
+    BinGateState state;
+    state.allocate (1);
+    state.gains[0] = 0.0f;
+
+    SpectralKernels::GainSmoothing smoothing;
+    smoothing.attack = 0.5f;
+    smoothing.release = 0.75f;
+    smoothing.holdHops = 2;
+
+    // Opening: halfway to 1 each hop
+    REQUIRE_THAT (gateHop (state, 2.0f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.5, 1.0e-6));
+    REQUIRE_THAT (gateHop (state, 2.0f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.75, 1.0e-6));
+    REQUIRE_THAT (gateHop (state, 2.0f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.875, 1.0e-6));
+
+    // Closing: held for two hops, then a quarter of the way to 0 each hop
+    REQUIRE_THAT (gateHop (state, 0.5f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.875, 1.0e-6));
+    REQUIRE_THAT (gateHop (state, 0.5f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.875, 1.0e-6));
+    REQUIRE_THAT (gateHop (state, 0.5f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.65625, 1.0e-6));
+    REQUIRE_THAT (gateHop (state, 0.5f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.4921875, 1.0e-6));
+
+    // Reopening part way through the release attacks from where it got to, and restarts the hold
+    REQUIRE_THAT (gateHop (state, 2.0f, 1.0f, 1.0f, smoothing), Catch::Matchers::WithinAbs (0.74609375, 1.0e-6));
+    REQUIRE (state.holdCounters[0] == 2);
+}
+
+TEST_CASE ("Bins leaving the band go back to passing at unity", "[binstate]")
+{
+    constexpr int numBins = 70;
+    std::vector<float> power (numBins, 2.0f);
+
+    BinGateState state;
+    state.allocate (numBins);
+    SpectralKernels::updateOpenBits (power.data(), state.openBits.data(), numBins, 1.0f);
+    std::fill (state.gains.begin(), state.gains.end(), 0.25f);
+    std::fill (state.holdCounters.begin(), state.holdCounters.end(), 3);
+
+    state.setBand (32, 40);
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        INFO ("bin " << bin);
+        const bool inBand = bin >= 32 && bin < 40;
+        REQUIRE (SpectralKernels::isBinOpen (state.openBits.data(), bin) == inBand);
+        REQUIRE (state.gains[(size_t) bin] == (inBand ? 0.25f : 1.0f));
+        REQUIRE (state.holdCounters[(size_t) bin] == (inBand ? 3 : 0));
+    }
+}
+
+TEST_CASE ("Hysteresis stops bins near the cutoff chattering", "[binstate]")
+{
+    // Noise whose bins average just above the cutoff, so each hop puts many of them on the other side
+    const auto countFlips = [] (float hysteresisDb) {
+        PluginProcessor plugin;
+        setParameter (plugin, "cutoff", -20.0f);
+        setParameter (plugin, "hysteresis", hysteresisDb);
+        setParameter (plugin, "fftsize", 3.0f); // 512, one hop per 128-sample block
+        plugin.setPlayConfigDetails (1, 1, 48000.0, 128);
+        plugin.prepareToPlay (48000.0, 128);
+
+        juce::AudioBuffer<float> buffer (1, 128);
+        juce::Random random (31);
+        std::vector<float> magnitudes;
+        std::vector<bool> gateStatus, previous;
+        int flips = 0;
+
+        processBlocks (
+            plugin, buffer, 200,
+            [&] (juce::AudioBuffer<float>& input, int) { fillWithNoise (input, random, 0.006f); },
+            [&] (const juce::AudioBuffer<float>&, int) {
+                plugin.getSpectrumData (magnitudes, gateStatus);
+
+                if (previous.size() == gateStatus.size())
+                    for (size_t bin = 0; bin < gateStatus.size(); ++bin)
+                        flips += gateStatus[bin] != previous[bin] ? 1 : 0;
+
+                previous = gateStatus;
+            });
+
+        return flips;
+    };
+
+    const int withoutHysteresis = countFlips (0.0f);
+    const int withHysteresis = countFlips (12.0f);
+
+    INFO ("flips without hysteresis " << withoutHysteresis << ", with 12 dB " << withHysteresis);
+    REQUIRE (withoutHysteresis > 0);
+    REQUIRE (withHysteresis * 2 < withoutHysteresis);
+}
@@ -0,0 +1,113 @@
+#include <FastMath.h>
+#include <SpectralKernels.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <vector>
+
+TEST_CASE ("FastMath log2 accuracy", "[fastmath]")
+{
+    double maxError = 0.0;
+
+    // Every normal float exponent, 64 mantissa steps per octave
+    for (int exponent = -126; exponent < 128; ++exponent)
+    {
+        for (int step = 0; step < 64; ++step)
+        {
+            const auto x = std::ldexp (1.0f + static_cast<float> (step) / 64.0f, exponent);
+            maxError = std::max (maxError, std::abs (static_cast<double> (FastMath::log2 (x)) - std::log2 (static_cast<double> (x))));
+        }
+    }
+
+    INFO ("max absolute error " << maxError);
+    REQUIRE (maxError < 1.0e-5);
+}
+
+TEST_CASE ("FastMath exp2 accuracy", "[fastmath]")
+{
+    double maxRelativeError = 0.0;
+
+    for (int i = -126 * 256; i <= 126 * 256; ++i)
+    {
+        const auto x = static_cast<float> (i) / 256.0f;
+        const auto expected = std::exp2 (static_cast<double> (x));
+        maxRelativeError = std::max (maxRelativeError, std::abs (static_cast<double> (FastMath::exp2 (x)) - expected) / expected);
+    }
+
+    INFO ("max relative error " << maxRelativeError);
+    REQUIRE (maxRelativeError < 1.0e-5);
+
+    SECTION ("clamps out of range input")
+    {
+        REQUIRE (std::isfinite (FastMath::exp2 (1000.0f)));
+        REQUIRE (FastMath::exp2 (-1000.0f) > 0.0f);
+    }
+}
+
+TEST_CASE ("FastMath array versions match the scalar ones", "[fastmath]")
+{
+    std::vector<float> input (1000), output (1000);
+
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = 0.001f + static_cast<float> (i) * 0.37f;
+
+    FastMath::log2 (input.data(), output.data(), static_cast<int> (input.size()));
+    for (size_t i = 0; i < input.size(); ++i)
+        CHECK (std::abs (output[i] - FastMath::log2 (input[i])) < 1.0e-6f);
+}
+
+namespace
+{
+    // Straightforward double precision version of the expander curve
+    double referenceExpanderGainDb (double power, const SpectralKernels::ExpanderCurve& curve)
+    {
+        const double over = 10.0 * std::log10 (power) - curve.thresholdDb;
+        const double slope = curve.ratio - 1.0;
+        const double knee = curve.kneeDb;
+        double gainDb = 0.0;
+
+        if (2.0 * over < -knee)
+            gainDb = slope * over;
+        else if (2.0 * std::abs (over) <= knee && knee > 0.0)
+            gainDb = -slope * (over - knee / 2.0) * (over - knee / 2.0) / (2.0 * knee);
+
+        return std::max (gainDb, -static_cast<double> (curve.rangeDb));
+    }
+}
+
+TEST_CASE ("Expander kernel follows the soft-knee curve", "[fastmath][expander]")
+{
+    std::vector<float> power, gains;
+
+    // -120 dB to +20 dB in 0.05 dB steps
+    for (int i = 0; i <= 2800; ++i)
+        power.push_back (std::pow (10.0f, (-120.0f + static_cast<float> (i) * 0.05f) / 10.0f));
+
+    gains.resize (power.size());
+
+    for (const auto curve : { SpectralKernels::ExpanderCurve { -30.0f, 4.0f, 6.0f, 40.0f },
+             SpectralKernels::ExpanderCurve { -50.0f, 20.0f, 24.0f, 96.0f },
+             SpectralKernels::ExpanderCurve { -10.0f, 2.0f, 0.0f, 20.0f },
+             SpectralKernels::ExpanderCurve { -30.0f, 1.0f, 6.0f, 40.0f } })
+    {
+        SpectralKernels::expanderGains (power.data(), gains.data(), static_cast<int> (power.size()), curve);
+
+        double maxErrorDb = 0.0;
+        for (size_t i = 0; i < power.size(); ++i)
+        {
+            const double gainDb = 20.0 * std::log10 (static_cast<double> (gains[i]));
+            maxErrorDb = std::max (maxErrorDb, std::abs (gainDb - referenceExpanderGainDb (power[i], curve)));
+        }
+
+        INFO ("threshold " << curve.thresholdDb << " ratio " << curve.ratio << " knee " << curve.kneeDb << ": max error " << maxErrorDb << " dB");
+        CHECK (maxErrorDb < 0.01);
+    }
+}
+
+TEST_CASE ("Gate kernel matches the hard gate", "[fastmath]")
+{
+    const std::vector<float> power { 0.0f, 0.5f, 0.999f, 1.0f, 4.0f };
+    std::vector<float> gains (power.size());
+
+    SpectralKernels::gateGains (power.data(), gains.data(), static_cast<int> (power.size()), 1.0f, 0.25f);
+    REQUIRE (gains == std::vector<float> { 0.25f, 0.25f, 0.25f, 1.0f, 1.0f });
+}
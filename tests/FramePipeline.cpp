@@ -0,0 +1,144 @@
+#include "helpers/test_helpers.h"
+#include <FrameWorker.h>
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // Mono, open gate, so the STFT only delays the input
+    std::vector<float> processMono (PluginProcessor& plugin, const std::vector<float>& input)
+    {
+        constexpr int blockSize = 512;
+        setParameter (plugin, "balance", 1.0f);
+        plugin.setPlayConfigDetails (1, 1, 48000.0, blockSize);
+        plugin.prepareToPlay (48000.0, blockSize);
+
+        return processChannels (plugin, { input }, blockSize)[0];
+    }
+}
+
+TEST_CASE ("Reported latency matches the delay through the STFT", "[pipeline]")
+{
+    std::vector<float> impulse (16 * 512, 0.0f);
+    constexpr int impulsePosition = 3000;
+    impulse[impulsePosition] = 1.0f;
+
+    for (const int fftThread : { 0, 1 })
+    {
+        PluginProcessor plugin;
+        setParameter (plugin, "fftthread", static_cast<float> (fftThread));
+        const auto output = processMono (plugin, impulse);
+
+        INFO ("fft thread " << fftThread);
+        REQUIRE (plugin.isFFTPipelined() == (fftThread == 1));
+        REQUIRE (plugin.getLatencySamples() == 1024 + (fftThread == 1 ? 256 : 0));
+
+        const auto peak = std::max_element (output.begin(), output.end()) - output.begin();
+        REQUIRE (peak == impulsePosition + plugin.getLatencySamples());
+    }
+}
+
+TEST_CASE ("Background synthesis is the audio thread output one hop later", "[pipeline]")
+{
+    juce::Random random (11);
+    std::vector<float> noise (24 * 512);
+    for (auto& sample : noise)
+        sample = random.nextFloat() - 0.5f;
+
+    PluginProcessor inPlace;
+    const auto expected = processMono (inPlace, noise);
+
+    PluginProcessor pipelined;
+    setParameter (pipelined, "fftthread", 1.0f);
+    const auto output = processMono (pipelined, noise);
+
+    // Whether each frame came from the worker or the late-frame fallback, the samples are the same
+    constexpr size_t hop = 256;
+    for (size_t n = 0; n + hop < noise.size(); ++n)
+        REQUIRE (std::abs (output[n + hop] - expected[n]) < 1.0e-6f);
+}
+
+TEST_CASE ("Switching the FFT thread updates the latency", "[pipeline]")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (48000.0, 512);
+    REQUIRE (plugin.getLatencySamples() == 1024);
+
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midi;
+    buffer.clear();
+
+    // Changes are picked up at the start of the next block
+    setParameter (plugin, "fftthread", 1.0f);
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getLatencySamples() == 1024 + 256);
+
+    setParameter (plugin, "fftsize", 5.0f);
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getLatencySamples() == 2048 + 512);
+
+    setParameter (plugin, "fftthread", 0.0f);
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getLatencySamples() == 2048);
+}
+
+TEST_CASE ("A frame the worker can't finish in time is missed, not waited for", "[pipeline]")
+{
+    std::atomic<bool> started { false };
+    std::atomic<bool> release { false };
+    std::atomic<int> numProcessed { 0 };
+
+    FrameWorker worker ([&] {
+        started = true;
+        while (! release)
+            juce::Thread::yield();
+        ++numProcessed;
+    });
+
+    worker.start();
+    worker.submit();
+
+    while (! started)
+        juce::Thread::yield();
+
+    // Stands in for a worker preempted part way through the frame
+    const auto maxWaitTicks = juce::Time::secondsToHighResolutionTicks (0.001);
+    REQUIRE (worker.collect (maxWaitTicks) == FrameWorker::Collected::missed);
+    REQUIRE_FALSE (worker.cancel (maxWaitTicks));
+    REQUIRE (worker.isPending());
+    REQUIRE (worker.getNumMissedFrames() == 1);
+
+    release = true;
+    const auto tenSeconds = juce::Time::secondsToHighResolutionTicks (10.0);
+    REQUIRE (worker.collect (tenSeconds) != FrameWorker::Collected::missed);
+    REQUIRE_FALSE (worker.isPending());
+    REQUIRE (numProcessed == 1);
+}
+
+TEST_CASE ("The worker thread only runs with Background selected", "[pipeline]")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (48000.0, 512);
+    REQUIRE_FALSE (plugin.isFFTWorkerRunning());
+
+    setParameter (plugin, "fftthread", 1.0f);
+    REQUIRE (plugin.isFFTWorkerRunning());
+
+    setParameter (plugin, "fftthread", 0.0f);
+    REQUIRE_FALSE (plugin.isFFTWorkerRunning());
+
+    // Automation from the audio thread is picked up on the message thread
+    runOnAudioThread ([&] { setParameter (plugin, "fftthread", 1.0f); });
+    REQUIRE_FALSE (plugin.isFFTWorkerRunning());
+    REQUIRE (runTimersUntil ([&] { return plugin.isFFTWorkerRunning(); }));
+
+    runOnAudioThread ([&] { setParameter (plugin, "fftthread", 0.0f); });
+    REQUIRE (runTimersUntil ([&] { return ! plugin.isFFTWorkerRunning(); }));
+
+    // prepareToPlay follows the choice too
+    setParameter (plugin, "fftthread", 1.0f);
+    plugin.releaseResources();
+    REQUIRE_FALSE (plugin.isFFTWorkerRunning());
+    plugin.prepareToPlay (48000.0, 512);
+    REQUIRE (plugin.isFFTWorkerRunning());
+}
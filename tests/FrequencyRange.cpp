@@ -0,0 +1,112 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+namespace
+{
+    constexpr int blockSize = 512;
+    constexpr double sampleRate = 48000.0;
+
+    float tone (double frequency, int64_t sample)
+    {
+        return 0.001f * static_cast<float> (std::sin (2.0 * juce::MathConstants<double>::pi * frequency * static_cast<double> (sample) / sampleRate));
+    }
+
+    // A 1 kHz tone under an 8 kHz one, both quiet enough that a 0 dB cutoff closes every bin the gate works on.
+    // Returns the largest difference between the last block and the 1 kHz tone alone, a latency later.
+    float runTwoTones (PluginProcessor& plugin)
+    {
+        setParameter (plugin, "cutoff", 0.0f);
+        setParameter (plugin, "balance", 0.0f);
+        plugin.setPlayConfigDetails (1, 1, sampleRate, blockSize);
+        plugin.prepareToPlay (sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        float maxError = 0.0f;
+
+        processBlocks (
+            plugin, buffer, 24,
+            [] (juce::AudioBuffer<float>& input, int block) {
+                const int64_t blockStart = static_cast<int64_t> (block) * blockSize;
+
+                for (int sample = 0; sample < blockSize; ++sample)
+                    input.setSample (0, sample, tone (1000.0, blockStart + sample) + tone (8000.0, blockStart + sample));
+            },
+            [&] (const juce::AudioBuffer<float>& output, int block) {
+                const int64_t blockStart = static_cast<int64_t> (block) * blockSize;
+                maxError = 0.0f;
+
+                for (int sample = 0; sample < blockSize; ++sample)
+                {
+                    const float expected = tone (1000.0, blockStart + sample - plugin.getLatencySamples());
+                    maxError = juce::jmax (maxError, std::abs (output.getSample (0, sample) - expected));
+                }
+            });
+
+        return maxError;
+    }
+}
+
+TEST_CASE ("Frequency limits pick the bins whose centres lie between them", "[frequencyrange]")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (sampleRate, blockSize);
+
+    // 1024 points at 48 kHz, 46.875 Hz per bin
+    constexpr int numBins = 513;
+    REQUIRE (plugin.getActiveBins (numBins) == juce::Range<int> (0, numBins));
+
+    setParameter (plugin, "lowfreq", 4000.0f);
+    setParameter (plugin, "highfreq", 16000.0f);
+    REQUIRE (plugin.getActiveBins (numBins) == juce::Range<int> (86, 342));
+
+    // Limits that cross gate nothing
+    setParameter (plugin, "lowfreq", 8000.0f);
+    setParameter (plugin, "highfreq", 4000.0f);
+    REQUIRE (plugin.getActiveBins (numBins).isEmpty());
+
+    // The top of the high limit reaches Nyquist at any rate
+    setParameter (plugin, "lowfreq", 0.0f);
+    setParameter (plugin, "highfreq", PluginProcessor::maxLimitHz);
+    plugin.prepareToPlay (96000.0, blockSize);
+    REQUIRE (plugin.getActiveBins (numBins).getEnd() == numBins);
+}
+
+TEST_CASE ("Bins outside the frequency limits pass untouched", "[frequencyrange]")
+{
+    SECTION ("whole spectrum gated")
+    {
+        PluginProcessor plugin;
+        REQUIRE (runTwoTones (plugin) > 0.8e-3f);
+    }
+
+    SECTION ("only 4-16 kHz gated")
+    {
+        PluginProcessor plugin;
+        setParameter (plugin, "lowfreq", 4000.0f);
+        setParameter (plugin, "highfreq", 16000.0f);
+        REQUIRE (runTwoTones (plugin) < 1.0e-5f);
+
+        // The 1 kHz bin shows as passing and the 8 kHz one as gated
+        std::vector<float> magnitudes;
+        std::vector<bool> gateStatus;
+        plugin.getSpectrumData (magnitudes, gateStatus);
+        REQUIRE (gateStatus.size() == 513);
+        REQUIRE (gateStatus[21]);
+        REQUIRE_FALSE (gateStatus[171]);
+
+        // Only measured out of the band while something is watching
+        REQUIRE (magnitudes[21] == 0.0f);
+        plugin.getSpectrogramRing().setConsumerActive (true);
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        juce::MidiBuffer midi;
+
+        for (int sample = 0; sample < blockSize; ++sample)
+            buffer.setSample (0, sample, tone (1000.0, sample));
+
+        plugin.processBlock (buffer, midi);
+        plugin.getSpectrumData (magnitudes, gateStatus);
+        REQUIRE (magnitudes[21] > 0.0f);
+    }
+}
@@ -0,0 +1,159 @@
+#include <KernelDispatch.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <juce_core/juce_core.h>
+#include <vector>
+
+namespace
+{
+    std::vector<float> randomVector (juce::Random& random, int size, float low, float high)
+    {
+        std::vector<float> values (static_cast<size_t> (size));
+        for (auto& value : values)
+            value = low + (high - low) * random.nextFloat();
+        return values;
+    }
+
+    // Largest difference relative to the reference value, with an absolute floor for values near 0
+    float maxRelativeError (const std::vector<float>& expected, const std::vector<float>& actual)
+    {
+        float maxError = 0.0f;
+        for (size_t i = 0; i < expected.size(); ++i)
+            maxError = std::max (maxError, std::abs (actual[i] - expected[i]) / std::max (std::abs (expected[i]), 1.0f));
+        return maxError;
+    }
+}
+
+TEST_CASE ("Kernel dispatch picks the last supported variant", "[kernels]")
+{
+    const auto supported = SpectralKernels::getSupportedKernels();
+
+    REQUIRE (! supported.empty());
+    REQUIRE (supported.front() == &SpectralKernels::scalarKernels);
+    REQUIRE (&SpectralKernels::getKernels() == supported.back());
+}
+
+TEST_CASE ("Every kernel variant matches the scalar reference", "[kernels]")
+{
+    // Odd so that every variant also runs its remainder loop
+    constexpr int size = 1027;
+    const auto& reference = SpectralKernels::scalarKernels;
+
+    juce::Random random (11);
+    const auto frame = randomVector (random, size, -1.0f, 1.0f);
+    const auto window = randomVector (random, size, 0.0f, 1.0f);
+    const auto real = randomVector (random, size, -10.0f, 10.0f);
+    const auto imag = randomVector (random, size, -10.0f, 10.0f);
+    const auto gains = randomVector (random, size, 0.0f, 1.0f);
+
+    // Powers spread over 120 dB, across the threshold and the knee
+    std::vector<float> power (static_cast<size_t> (size));
+    for (auto& value : power)
+        value = std::pow (10.0f, -12.0f * random.nextFloat());
+
+    SpectralKernels::ExpanderCurve curve;
+
+    for (const auto* kernels : SpectralKernels::getSupportedKernels())
+    {
+        INFO (kernels->name);
+
+        SECTION (std::string (kernels->name) + " applyWindow")
+        {
+            auto expected = frame, actual = frame;
+            reference.applyWindow (expected.data(), window.data(), size);
+            kernels->applyWindow (actual.data(), window.data(), size);
+            REQUIRE (maxRelativeError (expected, actual) < 1.0e-5f);
+        }
+
+        SECTION (std::string (kernels->name) + " computePower")
+        {
+            std::vector<float> expected (static_cast<size_t> (size)), actual (static_cast<size_t> (size));
+            reference.computePower (real.data(), imag.data(), expected.data(), size);
+            kernels->computePower (real.data(), imag.data(), actual.data(), size);
+            REQUIRE (maxRelativeError (expected, actual) < 1.0e-5f);
+        }
+
+        SECTION (std::string (kernels->name) + " gateGains")
+        {
+            std::vector<float> expected (static_cast<size_t> (size)), actual (static_cast<size_t> (size));
+            reference.gateGains (power.data(), expected.data(), size, 1.0e-6f, 0.25f);
+            kernels->gateGains (power.data(), actual.data(), size, 1.0e-6f, 0.25f);
+            REQUIRE (expected == actual);
+        }
+
+        SECTION (std::string (kernels->name) + " expanderGains")
+        {
+            std::vector<float> expected (static_cast<size_t> (size)), actual (static_cast<size_t> (size));
+            reference.expanderGains (power.data(), expected.data(), size, curve);
+            kernels->expanderGains (power.data(), actual.data(), size, curve);
+            REQUIRE (maxRelativeError (expected, actual) < 1.0e-5f);
+        }
+
+        SECTION (std::string (kernels->name) + " hysteresisDetection")
+        {
+            std::vector<uint32_t> openBits (static_cast<size_t> (SpectralKernels::getNumStateWords (size)));
+            for (auto& word : openBits)
+                word = static_cast<uint32_t> (random.nextInt());
+
+            std::vector<float> expected (static_cast<size_t> (size)), actual (static_cast<size_t> (size));
+            reference.hysteresisDetection (power.data(), expected.data(), openBits.data(), size, 4.0f);
+            kernels->hysteresisDetection (power.data(), actual.data(), openBits.data(), size, 4.0f);
+            REQUIRE (expected == actual);
+        }
+
+        SECTION (std::string (kernels->name) + " updateOpenBits")
+        {
+            const auto numWords = static_cast<size_t> (SpectralKernels::getNumStateWords (size));
+            std::vector<uint32_t> expected (numWords), actual (numWords);
+            reference.updateOpenBits (power.data(), expected.data(), size, 1.0e-6f);
+            kernels->updateOpenBits (power.data(), actual.data(), size, 1.0e-6f);
+            REQUIRE (expected == actual);
+        }
+
+        SECTION (std::string (kernels->name) + " smoothGains")
+        {
+            // Some bins rising, some falling with hold left, some releasing
+            std::vector<int32_t> holdCounters (static_cast<size_t> (size));
+            for (auto& counter : holdCounters)
+                counter = random.nextInt (3);
+
+            SpectralKernels::GainSmoothing smoothing;
+            smoothing.attack = 0.3f;
+            smoothing.release = 0.9f;
+            smoothing.holdHops = 4;
+
+            auto expectedGains = gains, actualGains = gains, expectedSmoothed = window, actualSmoothed = window;
+            auto expectedHold = holdCounters, actualHold = holdCounters;
+            reference.smoothGains (expectedGains.data(), expectedSmoothed.data(), expectedHold.data(), size, smoothing);
+            kernels->smoothGains (actualGains.data(), actualSmoothed.data(), actualHold.data(), size, smoothing);
+            REQUIRE (maxRelativeError (expectedGains, actualGains) < 1.0e-5f);
+            REQUIRE (maxRelativeError (expectedSmoothed, actualSmoothed) < 1.0e-5f);
+            REQUIRE (expectedHold == actualHold);
+        }
+
+        SECTION (std::string (kernels->name) + " applyGains")
+        {
+            auto expectedReal = real, expectedImag = imag, actualReal = real, actualImag = imag;
+            reference.applyGains (expectedReal.data(), expectedImag.data(), gains.data(), size);
+            kernels->applyGains (actualReal.data(), actualImag.data(), gains.data(), size);
+            REQUIRE (maxRelativeError (expectedReal, actualReal) < 1.0e-5f);
+            REQUIRE (maxRelativeError (expectedImag, actualImag) < 1.0e-5f);
+        }
+
+        SECTION (std::string (kernels->name) + " overlapAdd")
+        {
+            auto expected = real, actual = real;
+            reference.overlapAdd (expected.data(), frame.data(), 0.25f, size);
+            kernels->overlapAdd (actual.data(), frame.data(), 0.25f, size);
+            REQUIRE (maxRelativeError (expected, actual) < 1.0e-5f);
+        }
+
+        SECTION (std::string (kernels->name) + " mixDryWet")
+        {
+            auto expected = frame, actual = frame;
+            reference.mixDryWet (expected.data(), window.data(), 0.3f, size);
+            kernels->mixDryWet (actual.data(), window.data(), 0.3f, size);
+            REQUIRE (maxRelativeError (expected, actual) < 1.0e-5f);
+        }
+    }
+}
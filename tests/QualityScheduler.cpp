@@ -0,0 +1,331 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <QualityScheduler.h>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int blockSize = 512;
+    constexpr double sampleRate = 48000.0;
+    constexpr double blockSeconds = blockSize / sampleRate;
+
+    // Feeds blocks at a constant load until the level changes, and returns how long that took
+    double secondsUntilStep (QualityScheduler& scheduler, double load, double budget, int ceilingOrder, double limitSeconds = 20.0)
+    {
+        for (double seconds = blockSeconds; seconds < limitSeconds; seconds += blockSeconds)
+            if (scheduler.addBlock (load * blockSeconds, blockSeconds, budget, ceilingOrder))
+                return seconds;
+
+        return limitSeconds;
+    }
+
+    // Drives the processor's scheduler directly, as if its blocks had taken that long, with a budget of 1
+    void forceStep (PluginProcessor& plugin, double load)
+    {
+        auto& scheduler = plugin.getQualityScheduler();
+        const int level = scheduler.getLevel();
+        secondsUntilStep (scheduler, load, 1.0, 10);
+        REQUIRE (scheduler.getLevel() != level);
+    }
+
+    // Mono, open gate, Auto quality with the whole block as the budget, so only forced steps happen
+    void prepareAuto (PluginProcessor& plugin)
+    {
+        setParameter (plugin, "balance", 1.0f);
+        setParameter (plugin, "quality", 1.0f);
+        setParameter (plugin, "cpubudget", 1.0f);
+        plugin.setPlayConfigDetails (1, 1, sampleRate, blockSize);
+        plugin.prepareToPlay (sampleRate, blockSize);
+    }
+}
+
+TEST_CASE ("Quality ladder gets cheaper at every level", "[quality]")
+{
+    for (int ceiling = PluginProcessor::minFFTOrder; ceiling <= PluginProcessor::maxFFTOrder; ++ceiling)
+    {
+        const int numLevels = QualityScheduler::getNumLevels (ceiling, PluginProcessor::minFFTOrder);
+        INFO ("ceiling " << (1 << ceiling));
+
+        const auto top = QualityScheduler::getConfiguration (ceiling, 0);
+        REQUIRE (top.getSize() == 1 << ceiling);
+        REQUIRE (top.getHopSize() == top.getSize() / 4);
+
+        const auto bottom = QualityScheduler::getConfiguration (ceiling, numLevels - 1);
+        REQUIRE (bottom.order == PluginProcessor::minFFTOrder);
+        REQUIRE (bottom.getHopSize() == bottom.getSize() / 2);
+
+        for (int level = 1; level < numLevels; ++level)
+            REQUIRE (QualityScheduler::getRelativeCost (QualityScheduler::getConfiguration (ceiling, level))
+                     < QualityScheduler::getRelativeCost (QualityScheduler::getConfiguration (ceiling, level - 1)));
+    }
+}
+
+TEST_CASE ("Quality scheduler steps down one level per settle period while over budget", "[quality]")
+{
+    QualityScheduler scheduler;
+    scheduler.setNumLevels (QualityScheduler::getNumLevels (10, PluginProcessor::minFFTOrder));
+
+    for (int level = 1; level < scheduler.getNumLevels(); ++level)
+    {
+        const double seconds = secondsUntilStep (scheduler, 0.9, 0.5, 10);
+        INFO ("level " << level);
+        REQUIRE (scheduler.getLevel() == level);
+        REQUIRE (seconds >= QualityScheduler::settleSeconds);
+        REQUIRE (seconds < QualityScheduler::settleSeconds + 2.0 * blockSeconds);
+    }
+
+    // Nothing cheaper to go to
+    secondsUntilStep (scheduler, 0.9, 0.5, 10, 5.0);
+    REQUIRE (scheduler.getLevel() == scheduler.getNumLevels() - 1);
+}
+
+TEST_CASE ("Quality scheduler holds between its thresholds", "[quality]")
+{
+    // Level 1 is 1024 points at 50% overlap, level 2 512 points. Level 1 would cost
+    // 10/9 of level 2, level 0 twice level 1, and stepping up needs a prediction under 0.7 of the budget.
+    constexpr double budget = 0.5;
+    QualityScheduler scheduler;
+    scheduler.setNumLevels (QualityScheduler::getNumLevels (10, PluginProcessor::minFFTOrder));
+
+    secondsUntilStep (scheduler, 0.9, budget, 10);
+    secondsUntilStep (scheduler, 0.9, budget, 10);
+    REQUIRE (scheduler.getLevel() == 2);
+
+    SECTION ("under budget without enough headroom to step up")
+    {
+        // 0.45 predicts 0.5 at level 1
+        secondsUntilStep (scheduler, 0.45, budget, 10, 10.0);
+        REQUIRE (scheduler.getLevel() == 2);
+    }
+
+    SECTION ("steps up after the headroom lasts")
+    {
+        // 0.2 predicts 0.22 at level 1, but 0.44 at level 0
+        const double seconds = secondsUntilStep (scheduler, 0.2, budget, 10);
+        REQUIRE (scheduler.getLevel() == 1);
+        REQUIRE (seconds >= QualityScheduler::stepUpSeconds);
+        REQUIRE (seconds < QualityScheduler::stepUpSeconds + 0.5);
+
+        secondsUntilStep (scheduler, 0.2, budget, 10, 10.0);
+        REQUIRE (scheduler.getLevel() == 1);
+    }
+
+    SECTION ("a block over the margin restarts the wait")
+    {
+        secondsUntilStep (scheduler, 0.2, budget, 10, QualityScheduler::stepUpSeconds - 0.5);
+        secondsUntilStep (scheduler, 0.45, budget, 10, 0.5);
+        const double seconds = secondsUntilStep (scheduler, 0.2, budget, 10);
+        REQUIRE (scheduler.getLevel() == 1);
+        REQUIRE (seconds >= QualityScheduler::stepUpSeconds);
+    }
+}
+
+TEST_CASE ("Quality scheduler follows a load ramp without oscillating", "[quality]")
+{
+    // A load that costs what the level does, rising past the budget and falling back over 24 s, then holding
+    constexpr double budget = 0.5;
+    constexpr int ceiling = 10;
+    const double topCost = QualityScheduler::getRelativeCost (QualityScheduler::getConfiguration (ceiling, 0));
+
+    QualityScheduler scheduler;
+    scheduler.setNumLevels (QualityScheduler::getNumLevels (ceiling, PluginProcessor::minFFTOrder));
+
+    struct Step
+    {
+        double seconds, topLoad, averageLoad;
+        int from, to;
+    };
+
+    std::vector<Step> steps;
+
+    for (double seconds = 0.0; seconds < 30.0; seconds += blockSeconds)
+    {
+        const double topLoad = 0.2 + 1.2 * std::max (0.0, 1.0 - std::abs (seconds - 12.0) / 12.0);
+        const int level = scheduler.getLevel();
+        const double load = topLoad * QualityScheduler::getRelativeCost (QualityScheduler::getConfiguration (ceiling, level)) / topCost;
+
+        if (scheduler.addBlock (load * blockSeconds, blockSeconds, budget, ceiling))
+            steps.push_back ({ seconds, topLoad, scheduler.getAverageLoad(), level, scheduler.getLevel() });
+    }
+
+    REQUIRE (steps.size() >= 2);
+    REQUIRE (scheduler.getLevel() == 0);
+
+    bool steppedUp = false;
+
+    for (size_t index = 0; index < steps.size(); ++index)
+    {
+        const auto& step = steps[index];
+        INFO ("step " << step.from << " -> " << step.to << " at " << step.seconds << " s");
+        REQUIRE (std::abs (step.to - step.from) == 1);
+
+        if (step.to > step.from)
+        {
+            // Only over the budget, and never again once the load has started to fall
+            REQUIRE (step.averageLoad > budget);
+            REQUIRE_FALSE (steppedUp);
+        }
+        else
+        {
+            steppedUp = true;
+            REQUIRE (index > 0);
+            REQUIRE (step.seconds - steps[index - 1].seconds >= QualityScheduler::stepUpSeconds);
+
+            // Each level comes back at a lower load than it was left at
+            const auto left = std::find_if (steps.begin(), steps.end(), [&] (const Step& other) { return other.from == step.to && other.to == step.from; });
+            REQUIRE (left != steps.end());
+            REQUIRE (step.topLoad < left->topLoad);
+        }
+    }
+
+    REQUIRE (steppedUp);
+}
+
+TEST_CASE ("Auto quality switches configuration at the next frame and reports the latency", "[quality]")
+{
+    PluginProcessor plugin;
+    prepareAuto (plugin);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    buffer.clear();
+    plugin.processBlock (buffer, midi);
+
+    REQUIRE (plugin.getFFTSize() == 1024);
+    REQUIRE (plugin.getHopSize() == 256);
+    REQUIRE (plugin.getLatencySamples() == 1024);
+
+    // Level 1 keeps the size, and so the latency
+    forceStep (plugin, 10.0);
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getFFTSize() == 1024);
+    REQUIRE (plugin.getHopSize() == 512);
+    REQUIRE (plugin.getLatencySamples() == 1024);
+
+    forceStep (plugin, 10.0);
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getFFTSize() == 512);
+    REQUIRE (plugin.getHopSize() == 256);
+    REQUIRE (plugin.getLatencySamples() == 512);
+
+    SECTION ("background FFT thread")
+    {
+        setParameter (plugin, "fftthread", 1.0f);
+        plugin.processBlock (buffer, midi);
+
+        // A new FFT thread setting starts again from the top
+        REQUIRE (plugin.getQualityScheduler().getLevel() == 0);
+        REQUIRE (plugin.getLatencySamples() == 1024 + 256);
+
+        forceStep (plugin, 10.0);
+        plugin.processBlock (buffer, midi);
+        REQUIRE (plugin.getLatencySamples() == 1024 + 512);
+    }
+
+    SECTION ("fixed quality ignores the load")
+    {
+        setParameter (plugin, "quality", 0.0f);
+        plugin.processBlock (buffer, midi);
+        plugin.processBlock (buffer, midi);
+        REQUIRE (plugin.getFFTSize() == 1024);
+        REQUIRE (plugin.getHopSize() == 256);
+        REQUIRE (plugin.getLatencySamples() == 1024);
+
+        forceStep (plugin, 10.0);
+        plugin.processBlock (buffer, midi);
+        REQUIRE (plugin.getQualityScheduler().getLevel() == 0);
+        REQUIRE (plugin.getHopSize() == 256);
+    }
+}
+
+TEST_CASE ("A host restart after a latency change keeps the Auto level", "[quality]")
+{
+    PluginProcessor plugin;
+    prepareAuto (plugin);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    juce::MidiBuffer midi;
+    buffer.clear();
+
+    forceStep (plugin, 10.0);
+    forceStep (plugin, 10.0);
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getLatencySamples() == 512);
+
+    // The host answers the new latency with prepareToPlay at the same settings, which mustn't undo the step
+    plugin.prepareToPlay (sampleRate, blockSize);
+    REQUIRE (plugin.getQualityScheduler().getLevel() == 2);
+    REQUIRE (plugin.getFFTSize() == 512);
+    REQUIRE (plugin.getLatencySamples() == 512);
+
+    plugin.processBlock (buffer, midi);
+    REQUIRE (plugin.getLatencySamples() == 512);
+
+    // A new block size is a new load
+    plugin.prepareToPlay (sampleRate, blockSize / 2);
+    REQUIRE (plugin.getQualityScheduler().getLevel() == 0);
+    REQUIRE (plugin.getLatencySamples() == 1024);
+}
+
+TEST_CASE ("An Auto quality step on the audio thread reports its latency from the message thread", "[quality]")
+{
+    PluginProcessor plugin;
+    prepareAuto (plugin);
+
+    juce::AudioBuffer<float> buffer (1, blockSize);
+    buffer.clear();
+
+    forceStep (plugin, 10.0);
+    forceStep (plugin, 10.0);
+    runOnAudioThread ([&] {
+        juce::MidiBuffer midi;
+        plugin.processBlock (buffer, midi);
+    });
+
+    // Switched, but only flagged for the processor's timer to report
+    REQUIRE (plugin.getFFTSize() == 512);
+    REQUIRE (plugin.getLatencySamples() == 1024);
+    REQUIRE (runTimersUntil ([&] { return plugin.getLatencySamples() == 512; }));
+}
+
+TEST_CASE ("Auto quality crossfades between configurations without a dropout", "[quality]")
+{
+    // DC through an open gate comes out at 1 whatever the configuration and latency, so any
+    // gap or overlap in the handover shows up directly
+    for (const int fftThread : { 0, 1 })
+    {
+        PluginProcessor plugin;
+        setParameter (plugin, "fftthread", static_cast<float> (fftThread));
+        prepareAuto (plugin);
+
+        juce::AudioBuffer<float> buffer (1, blockSize);
+
+        processBlocks (
+            plugin, buffer, 40,
+            [&] (juce::AudioBuffer<float>& input, int block) {
+                // Down to 1024 points at 50% overlap, then to 512, and back up to 1024
+                if (block == 10 || block == 20)
+                    forceStep (plugin, 10.0);
+
+                if (block == 30)
+                    forceStep (plugin, 0.0);
+
+                for (int sample = 0; sample < blockSize; ++sample)
+                    input.setSample (0, sample, 1.0f);
+            },
+            [&] (const juce::AudioBuffer<float>& output, int block) {
+                // Past the initial latency
+                if (block < 4)
+                    return;
+
+                INFO ("fft thread " << fftThread << ", block " << block);
+
+                for (int sample = 0; sample < blockSize; ++sample)
+                    REQUIRE (std::abs (output.getSample (0, sample) - 1.0f) < 0.01f);
+            });
+
+        REQUIRE (plugin.getQualityScheduler().getLevel() == 1);
+    }
+}
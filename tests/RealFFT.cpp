@@ -0,0 +1,122 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <RealFFT.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <complex>
+#include <functional>
+
+namespace
+{
+    // RMS of the input and of the output over the last block, once the STFT has filled
+    std::pair<float, float> processSignal (PluginProcessor& plugin, const std::function<float (int)>& signal)
+    {
+        constexpr int blockSize = 512;
+        plugin.setPlayConfigDetails (1, 1, 48000.0, blockSize);
+        plugin.prepareToPlay (48000.0, blockSize);
+
+        juce::AudioBuffer<float> buffer (1, blockSize);
+        float inputRms = 0.0f;
+
+        processBlocks (plugin, buffer, 24, [&] (juce::AudioBuffer<float>& input, int block) {
+            for (int sample = 0; sample < blockSize; ++sample)
+                input.setSample (0, sample, signal (block * blockSize + sample));
+
+            inputRms = input.getRMSLevel (0, 0, blockSize);
+        });
+
+        return { inputRms, buffer.getRMSLevel (0, 0, blockSize) };
+    }
+}
+
+TEST_CASE ("Real FFT gives the N/2 + 1 bins of the DFT", "[fft]")
+{
+    juce::Random random (5);
+
+    for (int order = PluginProcessor::minFFTOrder; order <= PluginProcessor::maxFFTOrder; ++order)
+    {
+        RealFFT fft (order);
+        const int size = fft.getSize();
+        REQUIRE (fft.getNumBins() == size / 2 + 1);
+
+        std::vector<float> input (static_cast<size_t> (size));
+        std::vector<float> real (static_cast<size_t> (fft.getNumBins()));
+        std::vector<float> imag (static_cast<size_t> (fft.getNumBins()));
+
+        for (auto& sample : input)
+            sample = random.nextFloat() * 2.0f - 1.0f;
+
+        fft.forward (input.data(), real.data(), imag.data());
+
+        INFO ("size " << size);
+        REQUIRE (imag[0] == 0.0f);
+        REQUIRE (imag[static_cast<size_t> (size / 2)] == 0.0f);
+
+        double maxError = 0.0;
+        for (int bin = 0; bin <= size / 2; ++bin)
+        {
+            std::complex<double> expected;
+            for (int n = 0; n < size; ++n)
+                expected += static_cast<double> (input[static_cast<size_t> (n)])
+                            * std::polar (1.0, -2.0 * juce::MathConstants<double>::pi * bin * n / size);
+
+            maxError = std::max (maxError, std::abs (expected - std::complex<double> (real[static_cast<size_t> (bin)], imag[static_cast<size_t> (bin)])));
+        }
+
+        // Bin magnitudes reach ~sqrt (N) for this noise
+        CHECK (maxError < 1.0e-4 * size);
+    }
+}
+
+TEST_CASE ("Real FFT inverse undoes the forward transform", "[fft]")
+{
+    juce::Random random (6);
+
+    for (int order = PluginProcessor::minFFTOrder; order <= PluginProcessor::maxFFTOrder; ++order)
+    {
+        RealFFT fft (order);
+        const auto size = static_cast<size_t> (fft.getSize());
+        std::vector<float> input (size), output (size);
+        std::vector<float> real (size / 2 + 1), imag (size / 2 + 1);
+
+        for (auto& sample : input)
+            sample = random.nextFloat() * 2.0f - 1.0f;
+
+        fft.forward (input.data(), real.data(), imag.data());
+        fft.inverse (real.data(), imag.data(), output.data());
+
+        INFO ("size " << size);
+        for (size_t n = 0; n < size; ++n)
+            REQUIRE (std::abs (output[n] - input[n]) < 1.0e-5f);
+    }
+}
+
+TEST_CASE ("STFT gates the band edges and passes an open gate at unity", "[fft]")
+{
+    PluginProcessor plugin;
+
+    SECTION ("an open gate leaves the level unchanged")
+    {
+        juce::Random random (7);
+        setParameter (plugin, "balance", 1.0f);
+
+        const auto [inputRms, outputRms] = processSignal (plugin, [&] (int) { return random.nextFloat() - 0.5f; });
+        REQUIRE (outputRms > 0.9f * inputRms);
+        REQUIRE (outputRms < 1.1f * inputRms);
+    }
+
+    // Far below the -30 dB cutoff, so a full strength gate removes them
+    setParameter (plugin, "balance", 0.0f);
+
+    SECTION ("Nyquist")
+    {
+        const auto [inputRms, outputRms] = processSignal (plugin, [] (int n) { return n % 2 == 0 ? 1.0e-5f : -1.0e-5f; });
+        REQUIRE (outputRms < 0.01f * inputRms);
+    }
+
+    SECTION ("DC")
+    {
+        const auto [inputRms, outputRms] = processSignal (plugin, [] (int) { return 1.0e-5f; });
+        REQUIRE (outputRms < 0.01f * inputRms);
+    }
+}
@@ -0,0 +1,247 @@
+#include "helpers/realtime_audit.h"
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // On a thread standing in for the host's audio thread, as the tests run on the message thread, which
+    // takes other paths. Refills the buffer outside the region, then only processBlock runs inside it.
+    realtime_audit::Report auditBlocks (PluginProcessor& plugin, int blockSize, int numBlocks)
+    {
+        // Room for every bus, including an enabled sidechain
+        juce::AudioBuffer<float> buffer (juce::jmax (plugin.getTotalNumInputChannels(), plugin.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midiBuffer;
+        juce::Random random (42);
+        realtime_audit::Report total;
+
+        runOnAudioThread ([&] {
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                fillWithNoise (buffer, random);
+
+                const auto report = realtime_audit::checkRealtimeSafety ([&] {
+                    plugin.processBlock (buffer, midiBuffer);
+                });
+
+                total.allocations += report.allocations;
+                total.deallocations += report.deallocations;
+                total.blockingCalls += report.blockingCalls;
+                total.systemCalls += report.systemCalls;
+
+                if (total.firstViolation == nullptr)
+                    total.firstViolation = report.firstViolation;
+            }
+        });
+
+        return total;
+    }
+}
+
+TEST_CASE ("Realtime audit catches violations", "[realtime]")
+{
+    SECTION ("allocations")
+    {
+        std::unique_ptr<std::vector<float>> escaped;
+        const auto report = realtime_audit::checkRealtimeSafety ([&] {
+            escaped = std::make_unique<std::vector<float>> (64);
+        });
+
+        REQUIRE (report.allocations > 0);
+    }
+
+    SECTION ("locks")
+    {
+        if (! realtime_audit::canDetectBlockingCalls())
+            SKIP ("Blocking calls are only intercepted on Linux/glibc");
+
+        juce::CriticalSection lock;
+        const auto report = realtime_audit::checkRealtimeSafety ([&] {
+            const juce::ScopedLock scopedLock (lock);
+        });
+
+        REQUIRE (report.blockingCalls > 0);
+    }
+
+    SECTION ("posting a message")
+    {
+        if (! realtime_audit::canDetectBlockingCalls())
+            SKIP ("System calls are only intercepted on Linux/glibc");
+
+        struct Updater : juce::AsyncUpdater
+        {
+            void handleAsyncUpdate() override {}
+        } updater;
+
+        realtime_audit::Report report;
+        runOnAudioThread ([&] {
+            report = realtime_audit::checkRealtimeSafety ([&] { updater.triggerAsyncUpdate(); });
+        });
+
+        updater.cancelPendingUpdate();
+        REQUIRE_FALSE (report.isClean());
+    }
+
+    SECTION ("nothing outside a region")
+    {
+        const auto report = realtime_audit::checkRealtimeSafety ([] {});
+        REQUIRE (report.isClean());
+    }
+}
+
+TEST_CASE ("processBlock is realtime safe", "[realtime]")
+{
+    PluginProcessor plugin;
+    plugin.prepareToPlay (48000.0, 512);
+
+    SECTION ("varying block sizes")
+    {
+        for (const int blockSize : { 1, 7, 64, 128, 333, 512 })
+        {
+            const auto report = auditBlocks (plugin, blockSize, 16);
+            INFO ("block size " << blockSize << ": " << report.describe());
+            REQUIRE (report.isClean());
+        }
+    }
+
+    SECTION ("blocks larger than prepared")
+    {
+        const auto report = auditBlocks (plugin, 4096, 4);
+        INFO (report.describe());
+        REQUIRE (report.isClean());
+    }
+
+    SECTION ("FFT size changes")
+    {
+        // Walk every size up and back down so each switch happens on the audio thread
+        for (const int sizeIndex : { 0, 1, 2, 3, 4, 5, 4, 2, 0, 5 })
+        {
+            setParameter (plugin, "fftsize", static_cast<float> (sizeIndex));
+            const auto report = auditBlocks (plugin, 256, 4);
+            INFO ("size index " << sizeIndex << ": " << report.describe());
+            REQUIRE (report.isClean());
+        }
+    }
+
+    SECTION ("parameter automation")
+    {
+        juce::Random random (7);
+
+        for (int block = 0; block < 64; ++block)
+        {
+            setParameter (plugin, "cutoff", -60.0f + 60.0f * random.nextFloat());
+            setParameter (plugin, "balance", random.nextFloat());
+            setParameter (plugin, "drywet", random.nextFloat());
+            setParameter (plugin, "lowfreq", 2000.0f * random.nextFloat());
+            setParameter (plugin, "highfreq", 2000.0f + 18000.0f * random.nextFloat());
+
+            const auto report = auditBlocks (plugin, 128, 1);
+            INFO ("block " << block << ": " << report.describe());
+            REQUIRE (report.isClean());
+        }
+    }
+
+    SECTION ("with the spectrogram being watched")
+    {
+        plugin.getSpectrogramRing().setConsumerActive (true);
+        const auto report = auditBlocks (plugin, 512, 32);
+        INFO (report.describe());
+        REQUIRE (report.isClean());
+    }
+
+    SECTION ("while capturing")
+    {
+        const auto file = juce::File::createTempFile (".sgcap");
+        REQUIRE (plugin.startCapture (file));
+        plugin.getSpectrogramRing().setConsumerActive (true);
+
+        const auto report = auditBlocks (plugin, 512, 32);
+        plugin.stopCapture();
+        file.deleteFile();
+
+        INFO (report.describe());
+        REQUIRE (report.isClean());
+    }
+
+    SECTION ("with frames synthesised in the background")
+    {
+        setParameter (plugin, "fftthread", 1.0f);
+
+        for (const int sizeIndex : { 4, 5, 3 })
+        {
+            setParameter (plugin, "fftsize", static_cast<float> (sizeIndex));
+            const auto report = auditBlocks (plugin, 128, 32);
+            INFO ("size index " << sizeIndex << ": " << report.describe());
+            REQUIRE (report.isClean());
+        }
+    }
+
+    SECTION ("Auto quality switching levels")
+    {
+        setParameter (plugin, "quality", 1.0f);
+        auto& scheduler = plugin.getQualityScheduler();
+        constexpr double blockSeconds = 256.0 / 48000.0;
+
+        // Down the whole ladder as if overloaded, then back up with headroom. Each switch, and the
+        // latency change it flags, happens in the first audited block after the step.
+        for (const double load : { 10.0, 10.0, 10.0, 10.0, 10.0, 0.0, 0.0, 0.0 })
+        {
+            // Well past the settle and step up times, in case the scheduler never moves
+            const int level = scheduler.getLevel();
+            for (double seconds = 0.0; seconds < 20.0 && scheduler.getLevel() == level; seconds += blockSeconds)
+                scheduler.addBlock (load * blockSeconds, blockSeconds, 0.5, 10);
+
+            REQUIRE (scheduler.getLevel() != level);
+
+            const auto report = auditBlocks (plugin, 256, 8);
+            INFO ("level " << scheduler.getLevel() << ": " << report.describe());
+            REQUIRE (report.isClean());
+        }
+    }
+
+    SECTION ("FFT thread automated from the audio thread")
+    {
+        auto* param = plugin.getParameters().getParameter ("fftthread");
+        realtime_audit::Report automation;
+
+        runOnAudioThread ([&] {
+            // The first notification can size JUCE's listener bookkeeping
+            param->setValueNotifyingHost (0.0f);
+
+            automation = realtime_audit::checkRealtimeSafety ([&] {
+                param->setValueNotifyingHost (1.0f);
+            });
+        });
+
+        // JUCE notifies parameter listeners under uncontended locks of its own, as it does for any host
+        // automation, so only what the processor could add is checked: no allocations and no message posts
+        INFO (automation.describe());
+        REQUIRE (automation.allocations == 0);
+        REQUIRE (automation.deallocations == 0);
+        REQUIRE (automation.systemCalls == 0);
+
+        // The switch to the pipelined configuration happens in the next block
+        const auto report = auditBlocks (plugin, 256, 8);
+        INFO (report.describe());
+        REQUIRE (report.isClean());
+        REQUIRE (plugin.isFFTPipelined());
+        REQUIRE (runTimersUntil ([&] { return plugin.isFFTWorkerRunning(); }));
+    }
+
+    SECTION ("with the sidechain driving the mask")
+    {
+        auto layout = plugin.getBusesLayout();
+        layout.inputBuses.getReference (1) = juce::AudioChannelSet::stereo();
+        REQUIRE (plugin.setBusesLayout (layout));
+        plugin.prepareToPlay (48000.0, 512);
+
+        // Switching detector on the audio thread brings the key in and out
+        for (const int detector : { 1, 2, 0, 1 })
+        {
+            setParameter (plugin, "detector", static_cast<float> (detector));
+            const auto report = auditBlocks (plugin, 256, 8);
+            INFO ("detector " << detector << ": " << report.describe());
+            REQUIRE (report.isClean());
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+namespace
+{
+    bool enableSidechain (PluginProcessor& plugin, const juce::AudioChannelSet& keySet)
+    {
+        auto layout = plugin.getBusesLayout();
+        layout.inputBuses.getReference (1) = keySet;
+        return plugin.setBusesLayout (layout);
+    }
+
+    // Feeds a tone far below the cutoff to the main input and, when there is a key bus, a loud one to the key.
+    // Returns the RMS of the main output over the last block.
+    float runQuietMainLoudKey (PluginProcessor& plugin)
+    {
+        constexpr int blockSize = 512;
+        plugin.prepareToPlay (48000.0, blockSize);
+
+        juce::AudioBuffer<float> buffer (plugin.getTotalNumInputChannels(), blockSize);
+        const int numMainChannels = plugin.getMainBusNumInputChannels();
+        const double phaseStep = 2.0 * juce::MathConstants<double>::pi * 1000.0 / 48000.0;
+
+        processBlocks (plugin, buffer, 16, [&] (juce::AudioBuffer<float>& input, int block) {
+            for (int sample = 0; sample < blockSize; ++sample)
+            {
+                const auto tone = static_cast<float> (std::sin (phaseStep * (block * blockSize + sample)));
+
+                for (int channel = 0; channel < input.getNumChannels(); ++channel)
+                    input.setSample (channel, sample, channel < numMainChannels ? 1.0e-5f * tone : 0.5f * tone);
+            }
+        });
+
+        return buffer.getRMSLevel (0, 0, blockSize);
+    }
+}
+
+TEST_CASE ("Sidechain bus is optional, mono or stereo", "[sidechain]")
+{
+    PluginProcessor plugin;
+
+    REQUIRE (plugin.getBusCount (true) == 2);
+    REQUIRE_FALSE (plugin.getBus (true, 1)->isEnabled());
+
+    REQUIRE (enableSidechain (plugin, juce::AudioChannelSet::mono()));
+    REQUIRE (enableSidechain (plugin, juce::AudioChannelSet::stereo()));
+    REQUIRE_FALSE (enableSidechain (plugin, juce::AudioChannelSet::create5point1()));
+    REQUIRE (enableSidechain (plugin, juce::AudioChannelSet::disabled()));
+}
+
+TEST_CASE ("Key drives the mask applied to the main signal", "[sidechain]")
+{
+    // The same signal through a gate that never attenuates, as the level an open gate gives
+    float openGateRms = 0.0f;
+    {
+        PluginProcessor reference;
+        setParameter (reference, "balance", 1.0f);
+        openGateRms = runQuietMainLoudKey (reference);
+        REQUIRE (openGateRms > 0.0f);
+    }
+
+    // Hard gate with full attenuation, so a closed bin is silent
+    PluginProcessor plugin;
+    setParameter (plugin, "balance", 0.0f);
+
+    SECTION ("main detector ignores the key")
+    {
+        REQUIRE (enableSidechain (plugin, juce::AudioChannelSet::stereo()));
+        setParameter (plugin, "detector", 0.0f);
+        REQUIRE (runQuietMainLoudKey (plugin) < 0.01f * openGateRms);
+    }
+
+    SECTION ("key detector opens the gate for the quiet main signal")
+    {
+        REQUIRE (enableSidechain (plugin, juce::AudioChannelSet::stereo()));
+        setParameter (plugin, "detector", 1.0f);
+        REQUIRE (runQuietMainLoudKey (plugin) > 0.5f * openGateRms);
+    }
+
+    SECTION ("combined detection opens on either signal")
+    {
+        REQUIRE (enableSidechain (plugin, juce::AudioChannelSet::mono()));
+        setParameter (plugin, "detector", 2.0f);
+        REQUIRE (runQuietMainLoudKey (plugin) > 0.5f * openGateRms);
+    }
+
+    SECTION ("a disconnected key falls back to the main signal")
+    {
+        setParameter (plugin, "detector", 1.0f);
+        REQUIRE (runQuietMainLoudKey (plugin) < 0.01f * openGateRms);
+    }
+}
@@ -0,0 +1,90 @@
+#include <PluginProcessor.h>
+#include <SpectrogramFrameRing.h>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE ("Spectrogram level quantisation", "[spectrogram]")
+{
+    SECTION ("full scale maps to the top level")
+    {
+        REQUIRE (SpectrogramFrameRing::quantiseLevel (1.0f) == 255);
+    }
+
+    SECTION ("silence and the floor map to zero")
+    {
+        REQUIRE (SpectrogramFrameRing::quantiseLevel (0.0f) == 0);
+        REQUIRE (SpectrogramFrameRing::quantiseLevel (juce::Decibels::decibelsToGain (-120.0f)) == 0);
+    }
+
+    SECTION ("levels are log spaced")
+    {
+        const int halfway = SpectrogramFrameRing::quantiseLevel (juce::Decibels::decibelsToGain (-48.0f));
+        REQUIRE (halfway >= 127);
+        REQUIRE (halfway <= 128);
+    }
+}
+
+TEST_CASE ("Spectrogram frame ring", "[spectrogram]")
+{
+    SpectrogramFrameRing ring (4, 65);
+
+    SECTION ("frames round trip with their gate mask")
+    {
+        auto writer = ring.startFrame (65);
+        REQUIRE (writer.isValid());
+
+        for (int bin = 0; bin < 65; ++bin)
+            writer.setBin (bin, 1.0f, bin % 3 == 0);
+
+        ring.finishFrame (writer);
+        REQUIRE (ring.getNumReady() == 1);
+
+        int numChecked = 0;
+        ring.drain (1, [&] (const SpectrogramFrameRing::Frame& frame) {
+            REQUIRE (frame.numBins == 65);
+
+            for (int bin = 0; bin < frame.numBins; ++bin)
+            {
+                CHECK (frame.levels[bin] == 255);
+                CHECK (frame.isBinOpen (bin) == (bin % 3 == 0));
+            }
+
+            ++numChecked;
+        });
+
+        REQUIRE (numChecked == 1);
+        REQUIRE (ring.getNumReady() == 0);
+    }
+
+    SECTION ("a full ring drops frames instead of blocking")
+    {
+        for (int i = 0; i < 3; ++i)
+            ring.finishFrame (ring.startFrame (65));
+
+        REQUIRE_FALSE (ring.startFrame (65).isValid());
+
+        ring.discardAllBut (1);
+        REQUIRE (ring.getNumReady() == 1);
+        REQUIRE (ring.startFrame (65).isValid());
+    }
+}
+
+TEST_CASE ("Processor feeds the spectrogram only while it is watched", "[spectrogram]")
+{
+    PluginProcessor testPlugin;
+    testPlugin.prepareToPlay (44100.0, 512);
+
+    juce::AudioBuffer<float> buffer (2, 512);
+    juce::MidiBuffer midiBuffer;
+    auto& ring = testPlugin.getSpectrogramRing();
+
+    buffer.clear();
+    testPlugin.processBlock (buffer, midiBuffer);
+    testPlugin.processBlock (buffer, midiBuffer);
+    REQUIRE (ring.getNumReady() == 0);
+
+    ring.setConsumerActive (true);
+    buffer.clear();
+    testPlugin.processBlock (buffer, midiBuffer);
+    testPlugin.processBlock (buffer, midiBuffer);
+    REQUIRE (ring.getNumReady() > 0);
+}
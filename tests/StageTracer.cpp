@@ -0,0 +1,126 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <StageTracer.h>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+namespace
+{
+    juce::File tempTraceFile()
+    {
+        return juce::File::getSpecialLocation (juce::File::tempDirectory).getNonexistentChildFile ("stage-trace", ".json");
+    }
+
+    juce::StringArray eventNames (const juce::var& trace)
+    {
+        juce::StringArray names;
+
+        if (auto* events = trace["traceEvents"].getArray())
+            for (const auto& event : *events)
+                names.addIfNotAlreadyThere (event["name"].toString());
+
+        return names;
+    }
+}
+
+TEST_CASE ("Stage tracer writes Chrome trace events", "[tracing]")
+{
+    const auto file = tempTraceFile();
+    const auto otherFile = tempTraceFile();
+
+    {
+        StageTracer tracer (file);
+        REQUIRE (tracer.start());
+        REQUIRE (StageTracer::isActive());
+
+        {
+            const StageTracer::Scope outer ("outer");
+            const StageTracer::Scope inner ("inner");
+        }
+
+        SECTION ("only one tracer is active at a time")
+        {
+            StageTracer other (otherFile);
+            REQUIRE_FALSE (other.start());
+        }
+    }
+
+    REQUIRE_FALSE (StageTracer::isActive());
+
+    const auto trace = juce::JSON::parse (file);
+    auto* events = trace["traceEvents"].getArray();
+    REQUIRE (events != nullptr);
+    REQUIRE (events->size() == 2);
+
+    for (const auto& event : *events)
+    {
+        CHECK (event["ph"].toString() == "X");
+        CHECK (static_cast<double> (event["dur"]) >= 0.0);
+    }
+
+    // Inner closes first, so it's recorded first, and it starts no earlier than outer
+    CHECK ((*events)[0]["name"].toString() == "inner");
+    CHECK ((*events)[1]["name"].toString() == "outer");
+    CHECK (static_cast<double> ((*events)[0]["ts"]) >= static_cast<double> ((*events)[1]["ts"]));
+
+    file.deleteFile();
+    otherFile.deleteFile();
+}
+
+TEST_CASE ("A tracer can go away while other threads are recording", "[tracing]")
+{
+    const auto file = tempTraceFile();
+    std::atomic<bool> stop { false };
+    std::vector<std::thread> recorders;
+
+    {
+        StageTracer tracer (file);
+        REQUIRE (tracer.start());
+
+        for (int i = 0; i < 4; ++i)
+            recorders.emplace_back ([&] {
+                while (! stop)
+                {
+                    const StageTracer::Scope scope ("busy");
+                }
+            });
+
+        juce::Thread::sleep (20);
+    }
+
+    // Still recording as it went, so the destructor had to wait out any event in flight
+    REQUIRE_FALSE (StageTracer::isActive());
+    stop = true;
+
+    for (auto& recorder : recorders)
+        recorder.join();
+
+    REQUIRE (juce::JSON::parse (file)["traceEvents"].isArray());
+    file.deleteFile();
+}
+
+#if SPECTRAL_GATE_TRACING
+TEST_CASE ("Processor records every pipeline stage", "[tracing]")
+{
+    const auto file = tempTraceFile();
+
+    {
+        // Installed before the processor, so its shared tracer stands aside
+        StageTracer tracer (file);
+        REQUIRE (tracer.start());
+
+        PluginProcessor testPlugin;
+        testPlugin.prepareToPlay (44100.0, 512);
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        processBlocks (testPlugin, buffer, 8, [] (juce::AudioBuffer<float>& input, int) { input.clear(); });
+    }
+
+    const auto names = eventNames (juce::JSON::parse (file));
+
+    for (const auto* stage : { "processBlock", "STFT", "processFFTFrame", "window", "forward FFT", "mask", "inverse FFT", "overlap-add", "dry/wet mix" })
+        CHECK (names.contains (stage));
+
+    file.deleteFile();
+}
+#endif
@@ -0,0 +1,161 @@
+#include "helpers/test_helpers.h"
+#include <PluginProcessor.h>
+#include <RealFFT.h>
+#include <StereoFFT.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+    std::vector<float> randomVector (juce::Random& random, size_t size)
+    {
+        std::vector<float> values (size);
+        for (auto& value : values)
+            value = random.nextFloat() * 2.0f - 1.0f;
+        return values;
+    }
+
+    // Runs every channel of input through the plugin in 512-sample blocks
+    std::vector<std::vector<float>> process (PluginProcessor& plugin, const std::vector<std::vector<float>>& input)
+    {
+        constexpr int blockSize = 512;
+        const auto numChannels = static_cast<int> (input.size());
+        plugin.setPlayConfigDetails (numChannels, numChannels, 48000.0, blockSize);
+        plugin.prepareToPlay (48000.0, blockSize);
+
+        return processChannels (plugin, input, blockSize);
+    }
+}
+
+TEST_CASE ("Stereo FFT gives each channel the RealFFT bins", "[fft]")
+{
+    juce::Random random (21);
+
+    for (int order = PluginProcessor::minFFTOrder; order <= PluginProcessor::maxFFTOrder; ++order)
+    {
+        StereoFFT stereo (order);
+        RealFFT mono (order);
+        const auto size = static_cast<size_t> (stereo.getSize());
+        const auto numBins = static_cast<size_t> (stereo.getNumBins());
+        REQUIRE (stereo.getNumBins() == mono.getNumBins());
+
+        const auto left = randomVector (random, size);
+        const auto right = randomVector (random, size);
+        std::vector<float> leftReal (numBins), leftImag (numBins), rightReal (numBins), rightImag (numBins);
+        std::vector<float> expectedReal (numBins), expectedImag (numBins);
+
+        stereo.forward (left.data(), right.data(), leftReal.data(), leftImag.data(), rightReal.data(), rightImag.data());
+
+        INFO ("size " << size);
+
+        // Bin magnitudes reach ~sqrt (N) for this noise
+        const float tolerance = 1.0e-5f * static_cast<float> (size);
+
+        mono.forward (left.data(), expectedReal.data(), expectedImag.data());
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            REQUIRE (std::abs (leftReal[bin] - expectedReal[bin]) < tolerance);
+            REQUIRE (std::abs (leftImag[bin] - expectedImag[bin]) < tolerance);
+        }
+
+        mono.forward (right.data(), expectedReal.data(), expectedImag.data());
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            REQUIRE (std::abs (rightReal[bin] - expectedReal[bin]) < tolerance);
+            REQUIRE (std::abs (rightImag[bin] - expectedImag[bin]) < tolerance);
+        }
+    }
+}
+
+TEST_CASE ("Stereo FFT inverse matches RealFFT on differently gated channels", "[fft]")
+{
+    juce::Random random (22);
+
+    for (int order = PluginProcessor::minFFTOrder; order <= PluginProcessor::maxFFTOrder; ++order)
+    {
+        StereoFFT stereo (order);
+        RealFFT mono (order);
+        const auto size = static_cast<size_t> (stereo.getSize());
+        const auto numBins = static_cast<size_t> (stereo.getNumBins());
+
+        // Independent masks break the symmetry between the channels, which the inverse must not rely on
+        auto leftReal = randomVector (random, numBins), leftImag = randomVector (random, numBins);
+        auto rightReal = randomVector (random, numBins), rightImag = randomVector (random, numBins);
+
+        for (size_t bin = 0; bin < numBins; bin += 3)
+            leftReal[bin] = leftImag[bin] = 0.0f;
+
+        for (size_t bin = 1; bin < numBins; bin += 5)
+        {
+            rightReal[bin] *= 0.25f;
+            rightImag[bin] *= 0.25f;
+        }
+
+        std::vector<float> left (size), right (size), expected (size);
+        stereo.inverse (leftReal.data(), leftImag.data(), rightReal.data(), rightImag.data(), left.data(), right.data());
+
+        INFO ("size " << size);
+
+        mono.inverse (leftReal.data(), leftImag.data(), expected.data());
+        for (size_t n = 0; n < size; ++n)
+            REQUIRE (std::abs (left[n] - expected[n]) < 1.0e-5f);
+
+        mono.inverse (rightReal.data(), rightImag.data(), expected.data());
+        for (size_t n = 0; n < size; ++n)
+            REQUIRE (std::abs (right[n] - expected[n]) < 1.0e-5f);
+    }
+}
+
+TEST_CASE ("Stereo processing matches the per-channel path", "[fft]")
+{
+    // Mono processors take the per-channel RealFFT path, stereo ones the packed transform.
+    // Noise at -40 dB puts the bins either side of a -20 dB cutoff, so each channel gets its own mask.
+    juce::Random random (23);
+    auto left = randomVector (random, 24 * 512);
+    auto right = randomVector (random, 24 * 512);
+    juce::FloatVectorOperations::multiply (left.data(), 0.01f, static_cast<int> (left.size()));
+    juce::FloatVectorOperations::multiply (right.data(), 0.01f, static_cast<int> (right.size()));
+
+    const auto check = [&] (float tolerance, const std::function<void (PluginProcessor&)>& configure) {
+        PluginProcessor stereo, leftOnly, rightOnly;
+        for (auto* plugin : { &stereo, &leftOnly, &rightOnly })
+        {
+            setParameter (*plugin, "cutoff", -20.0f);
+            configure (*plugin);
+        }
+
+        const auto output = process (stereo, { left, right });
+        const auto expectedLeft = process (leftOnly, { left })[0];
+        const auto expectedRight = process (rightOnly, { right })[0];
+
+        for (size_t n = 0; n < left.size(); ++n)
+        {
+            REQUIRE (std::abs (output[0][n] - expectedLeft[n]) < tolerance);
+            REQUIRE (std::abs (output[1][n] - expectedRight[n]) < tolerance);
+        }
+    };
+
+    // The expander is continuous, so rounding differences between the transforms stay at rounding level
+    SECTION ("expander at every FFT size")
+    {
+        // Choice indices, 64 to 2048
+        for (int sizeIndex = 0; sizeIndex < 6; ++sizeIndex)
+        {
+            INFO ("size " << (64 << sizeIndex));
+            check (1.0e-6f, [sizeIndex] (PluginProcessor& plugin) {
+                setParameter (plugin, "mode", 1.0f);
+                setParameter (plugin, "fftsize", static_cast<float> (sizeIndex));
+            });
+        }
+    }
+
+    // A bin sitting right on the hard gate's threshold may land on either side. At 1024 points
+    // one such bin moves the output by at most 2 * cutoff / N * hop / N, about 5e-5.
+    SECTION ("gate")
+    {
+        check (1.0e-4f, [] (PluginProcessor& plugin) {
+            setParameter (plugin, "balance", 0.0f);
+        });
+    }
+}
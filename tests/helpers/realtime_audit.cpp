@@ -0,0 +1,368 @@
+#include "realtime_audit.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) && defined(__GLIBC__)
+    #define REALTIME_AUDIT_INTERPOSE_LIBC 1
+    #include <dlfcn.h>
+    #include <pthread.h>
+    #include <semaphore.h>
+    #include <time.h>
+    #include <unistd.h>
+#else
+    #define REALTIME_AUDIT_INTERPOSE_LIBC 0
+#endif
+
+#if defined(_WIN32)
+    #include <malloc.h>
+#endif
+
+namespace
+{
+    enum class Violation
+    {
+        allocation,
+        deallocation,
+        blockingCall,
+        systemCall
+    };
+
+    struct ThreadState
+    {
+        int depth = 0;
+        realtime_audit::Report report;
+    };
+
+    // constinit keeps this free of lazy TLS initialisation, which could itself allocate
+    constinit thread_local ThreadState threadState;
+
+    void noteViolation (Violation kind, const char* name) noexcept
+    {
+        auto& state = threadState;
+
+        if (state.depth == 0)
+            return;
+
+        switch (kind)
+        {
+            case Violation::allocation: ++state.report.allocations; break;
+            case Violation::deallocation: ++state.report.deallocations; break;
+            case Violation::blockingCall: ++state.report.blockingCalls; break;
+            case Violation::systemCall: ++state.report.systemCalls; break;
+        }
+
+        if (state.report.firstViolation == nullptr)
+            state.report.firstViolation = name;
+    }
+}
+
+//==============================================================================
+namespace realtime_audit
+{
+    std::string Report::describe() const
+    {
+        return std::to_string (allocations) + " allocation(s), "
+             + std::to_string (deallocations) + " deallocation(s), "
+             + std::to_string (blockingCalls) + " blocking call(s), "
+             + std::to_string (systemCalls) + " system call(s)"
+             + (firstViolation != nullptr ? std::string (", first: ") + firstViolation : std::string());
+    }
+
+    ScopedRealtimeRegion::ScopedRealtimeRegion() noexcept
+    {
+        if (threadState.depth++ == 0)
+            threadState.report = {};
+    }
+
+    ScopedRealtimeRegion::~ScopedRealtimeRegion() noexcept
+    {
+        --threadState.depth;
+    }
+
+    Report getLastReport() noexcept
+    {
+        return threadState.report;
+    }
+
+    bool canDetectBlockingCalls() noexcept
+    {
+        return REALTIME_AUDIT_INTERPOSE_LIBC != 0;
+    }
+}
+
+//==============================================================================
+// Raw allocation, bypassing the interposed malloc/free so nothing is counted twice
+#if REALTIME_AUDIT_INTERPOSE_LIBC
+extern "C" void* __libc_malloc (size_t);
+extern "C" void* __libc_calloc (size_t, size_t);
+extern "C" void* __libc_realloc (void*, size_t);
+extern "C" void* __libc_memalign (size_t, size_t);
+extern "C" void __libc_free (void*);
+#endif
+
+namespace
+{
+    void* rawAllocate (std::size_t size) noexcept
+    {
+       #if REALTIME_AUDIT_INTERPOSE_LIBC
+        return __libc_malloc (size == 0 ? 1 : size);
+       #else
+        return std::malloc (size == 0 ? 1 : size);
+       #endif
+    }
+
+    void rawFree (void* ptr) noexcept
+    {
+       #if REALTIME_AUDIT_INTERPOSE_LIBC
+        __libc_free (ptr);
+       #else
+        std::free (ptr);
+       #endif
+    }
+
+    void* rawAlignedAllocate (std::size_t size, std::align_val_t alignment) noexcept
+    {
+        const auto align = static_cast<std::size_t> (alignment);
+
+       #if REALTIME_AUDIT_INTERPOSE_LIBC
+        return __libc_memalign (align < sizeof (void*) ? sizeof (void*) : align, size == 0 ? 1 : size);
+       #elif defined(_WIN32)
+        return _aligned_malloc (size == 0 ? 1 : size, align);
+       #else
+        void* ptr = nullptr;
+        return posix_memalign (&ptr, align < sizeof (void*) ? sizeof (void*) : align, size == 0 ? 1 : size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    void rawAlignedFree (void* ptr) noexcept
+    {
+       #if defined(_WIN32)
+        _aligned_free (ptr);
+       #else
+        rawFree (ptr);
+       #endif
+    }
+
+    void* allocateOrThrow (std::size_t size)
+    {
+        noteViolation (Violation::allocation, "operator new");
+
+        if (auto* ptr = rawAllocate (size))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateAlignedOrThrow (std::size_t size, std::align_val_t alignment)
+    {
+        noteViolation (Violation::allocation, "operator new (aligned)");
+
+        if (auto* ptr = rawAlignedAllocate (size, alignment))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+    void deallocate (void* ptr) noexcept
+    {
+        if (ptr == nullptr)
+            return;
+
+        noteViolation (Violation::deallocation, "operator delete");
+        rawFree (ptr);
+    }
+
+    void deallocateAligned (void* ptr) noexcept
+    {
+        if (ptr == nullptr)
+            return;
+
+        noteViolation (Violation::deallocation, "operator delete (aligned)");
+        rawAlignedFree (ptr);
+    }
+}
+
+//==============================================================================
+// Global operator new/delete replacements, these apply to the whole executable
+void* operator new (std::size_t size) { return allocateOrThrow (size); }
+void* operator new[] (std::size_t size) { return allocateOrThrow (size); }
+void* operator new (std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow (size, alignment); }
+void* operator new[] (std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow (size, alignment); }
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    noteViolation (Violation::allocation, "operator new (nothrow)");
+    return rawAllocate (size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    noteViolation (Violation::allocation, "operator new[] (nothrow)");
+    return rawAllocate (size);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    noteViolation (Violation::allocation, "operator new (aligned, nothrow)");
+    return rawAlignedAllocate (size, alignment);
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    noteViolation (Violation::allocation, "operator new[] (aligned, nothrow)");
+    return rawAlignedAllocate (size, alignment);
+}
+
+void operator delete (void* ptr) noexcept { deallocate (ptr); }
+void operator delete[] (void* ptr) noexcept { deallocate (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept { deallocate (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept { deallocate (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept { deallocate (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept { deallocate (ptr); }
+void operator delete (void* ptr, std::align_val_t) noexcept { deallocateAligned (ptr); }
+void operator delete[] (void* ptr, std::align_val_t) noexcept { deallocateAligned (ptr); }
+void operator delete (void* ptr, std::size_t, std::align_val_t) noexcept { deallocateAligned (ptr); }
+void operator delete[] (void* ptr, std::size_t, std::align_val_t) noexcept { deallocateAligned (ptr); }
+void operator delete (void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned (ptr); }
+void operator delete[] (void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned (ptr); }
+
+//==============================================================================
+#if REALTIME_AUDIT_INTERPOSE_LIBC
+/* Symbols defined in the executable take precedence over libc's, so JUCE's
+ * HeapBlock (malloc) and CriticalSection (pthread_mutex_lock) land here too.
+ * The blocking calls are forwarded to the next definition via dlsym.
+ */
+namespace
+{
+    template <typename Function>
+    Function* resolveNext (std::atomic<Function*>& cache, const char* name) noexcept
+    {
+        auto* function = cache.load (std::memory_order_acquire);
+
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function*> (dlsym (RTLD_NEXT, name));
+            cache.store (function, std::memory_order_release);
+        }
+
+        return function;
+    }
+
+    std::atomic<int (*) (pthread_mutex_t*)> nextMutexLock { nullptr };
+    std::atomic<int (*) (pthread_rwlock_t*)> nextRwlockRdlock { nullptr };
+    std::atomic<int (*) (pthread_rwlock_t*)> nextRwlockWrlock { nullptr };
+    std::atomic<int (*) (sem_t*)> nextSemWait { nullptr };
+    std::atomic<int (*) (const timespec*, timespec*)> nextNanosleep { nullptr };
+    std::atomic<int (*) (useconds_t)> nextUsleep { nullptr };
+    std::atomic<ssize_t (*) (int, const void*, size_t)> nextWrite { nullptr };
+
+    // Resolve everything up front so the first call inside a region doesn't hit dlsym
+    [[maybe_unused]] const bool symbolsResolved = [] {
+        resolveNext (nextMutexLock, "pthread_mutex_lock");
+        resolveNext (nextRwlockRdlock, "pthread_rwlock_rdlock");
+        resolveNext (nextRwlockWrlock, "pthread_rwlock_wrlock");
+        resolveNext (nextSemWait, "sem_wait");
+        resolveNext (nextNanosleep, "nanosleep");
+        resolveNext (nextUsleep, "usleep");
+        resolveNext (nextWrite, "write");
+        return true;
+    }();
+}
+
+extern "C"
+{
+    void* malloc (size_t size) noexcept
+    {
+        noteViolation (Violation::allocation, "malloc");
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size) noexcept
+    {
+        noteViolation (Violation::allocation, "calloc");
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* ptr, size_t size) noexcept
+    {
+        noteViolation (Violation::allocation, "realloc");
+        return __libc_realloc (ptr, size);
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size) noexcept
+    {
+        noteViolation (Violation::allocation, "aligned_alloc");
+        return __libc_memalign (alignment, size);
+    }
+
+    int posix_memalign (void** ptr, size_t alignment, size_t size) noexcept
+    {
+        noteViolation (Violation::allocation, "posix_memalign");
+
+        if (alignment % sizeof (void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        auto* result = __libc_memalign (alignment, size);
+
+        if (result == nullptr)
+            return ENOMEM;
+
+        *ptr = result;
+        return 0;
+    }
+
+    void free (void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            noteViolation (Violation::deallocation, "free");
+
+        __libc_free (ptr);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        noteViolation (Violation::blockingCall, "pthread_mutex_lock");
+        return resolveNext (nextMutexLock, "pthread_mutex_lock") (mutex);
+    }
+
+    int pthread_rwlock_rdlock (pthread_rwlock_t* lock) noexcept
+    {
+        noteViolation (Violation::blockingCall, "pthread_rwlock_rdlock");
+        return resolveNext (nextRwlockRdlock, "pthread_rwlock_rdlock") (lock);
+    }
+
+    int pthread_rwlock_wrlock (pthread_rwlock_t* lock) noexcept
+    {
+        noteViolation (Violation::blockingCall, "pthread_rwlock_wrlock");
+        return resolveNext (nextRwlockWrlock, "pthread_rwlock_wrlock") (lock);
+    }
+
+    int sem_wait (sem_t* semaphore)
+    {
+        noteViolation (Violation::blockingCall, "sem_wait");
+        return resolveNext (nextSemWait, "sem_wait") (semaphore);
+    }
+
+    int nanosleep (const timespec* requested, timespec* remaining)
+    {
+        noteViolation (Violation::blockingCall, "nanosleep");
+        return resolveNext (nextNanosleep, "nanosleep") (requested, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        noteViolation (Violation::blockingCall, "usleep");
+        return resolveNext (nextUsleep, "usleep") (microseconds);
+    }
+
+    // JUCE posts a message by writing to a pipe or socket the message thread waits on
+    ssize_t write (int fd, const void* data, size_t size)
+    {
+        noteViolation (Violation::systemCall, "write");
+        return resolveNext (nextWrite, "write") (fd, data, size);
+    }
+}
+#endif
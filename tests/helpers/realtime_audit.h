@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+
+/* Test-only realtime-safety instrumentation.
+ *
+ * realtime_audit.cpp replaces the global operator new/delete for the Tests
+ * executable (and the PaintAllocations tool) and, on Linux/glibc, also interposes malloc/free, the aligned
+ * allocators, the blocking pthread, semaphore and sleep calls, and write, which
+ * is how JUCE posts a message. While a ScopedRealtimeRegion is alive on a
+ * thread, anything it catches on that thread is counted as a violation.
+ *
+ * Non-blocking calls such as pthread_mutex_trylock are allowed on purpose.
+ *
+ * Example usage:
+ *
+  const auto report = realtime_audit::checkRealtimeSafety ([&] {
+      plugin.processBlock (buffer, midi);
+  });
+  INFO (report.describe());
+  REQUIRE (report.isClean());
+
+ */
+namespace realtime_audit
+{
+    struct Report
+    {
+        int allocations = 0;
+        int deallocations = 0;
+        int blockingCalls = 0;
+        int systemCalls = 0;
+
+        // Name of the first offending call, points at a string literal
+        const char* firstViolation = nullptr;
+
+        bool isClean() const { return allocations == 0 && deallocations == 0 && blockingCalls == 0 && systemCalls == 0; }
+        std::string describe() const;
+    };
+
+    // Marks the current thread as realtime until destroyed, regions can nest
+    class ScopedRealtimeRegion
+    {
+    public:
+        ScopedRealtimeRegion() noexcept;
+        ~ScopedRealtimeRegion() noexcept;
+
+        ScopedRealtimeRegion (const ScopedRealtimeRegion&) = delete;
+        ScopedRealtimeRegion& operator= (const ScopedRealtimeRegion&) = delete;
+    };
+
+    // What the most recent outermost region on this thread caught
+    Report getLastReport() noexcept;
+
+    // False where only allocations can be intercepted (everything but Linux/glibc)
+    bool canDetectBlockingCalls() noexcept;
+
+    template <typename Function>
+    Report checkRealtimeSafety (Function&& function)
+    {
+        {
+            ScopedRealtimeRegion region;
+            function();
+        }
+
+        return getLastReport();
+    }
+}
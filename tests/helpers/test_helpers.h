@@ -1,5 +1,97 @@
 #pragma once
 #include <PluginProcessor.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Sets a parameter from its real-world value, e.g. a cutoff in dB or a choice index, the way a host would
+[[maybe_unused]] static void setParameter (PluginProcessor& plugin, const juce::String& id, float value)
+{
+    auto* param = plugin.getParameters().getParameter (id);
+    param->setValueNotifyingHost (param->convertTo0to1 (value));
+}
+
+// Uniform noise in [-amplitude, amplitude) on every channel
+[[maybe_unused]] static void fillWithNoise (juce::AudioBuffer<float>& buffer, juce::Random& random, float amplitude = 1.0f)
+{
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+            buffer.setSample (channel, sample, amplitude * (random.nextFloat() * 2.0f - 1.0f));
+}
+
+/* Runs numBlocks blocks of buffer's size through an already prepared plugin.
+ *
+ * fillBlock writes each block's input into the buffer before processBlock, and
+ * afterBlock, when given, looks at the output straight after it.
+ *
+ * Example usage:
+ *
+  processBlocks (plugin, buffer, 24,
+      [&] (juce::AudioBuffer<float>& input, int block) { fillWithNoise (input, random); },
+      [&] (const juce::AudioBuffer<float>& output, int block) { rms = output.getRMSLevel (0, 0, output.getNumSamples()); });
+
+ */
+[[maybe_unused]] static void processBlocks (PluginProcessor& plugin, juce::AudioBuffer<float>& buffer, int numBlocks,
+                                            const std::function<void (juce::AudioBuffer<float>& input, int block)>& fillBlock,
+                                            const std::function<void (const juce::AudioBuffer<float>& output, int block)>& afterBlock = nullptr)
+{
+    juce::MidiBuffer midi;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        fillBlock (buffer, block);
+        plugin.processBlock (buffer, midi);
+
+        if (afterBlock != nullptr)
+            afterBlock (buffer, block);
+    }
+}
+
+// Each channel of input through an already prepared plugin in blocks of blockSize. A trailing partial block stays silent.
+[[maybe_unused]] static std::vector<std::vector<float>> processChannels (PluginProcessor& plugin, const std::vector<std::vector<float>>& input, int blockSize)
+{
+    const auto numChannels = static_cast<int> (input.size());
+    const auto numSamples = input.front().size();
+    std::vector<std::vector<float>> output (input.size(), std::vector<float> (numSamples, 0.0f));
+    juce::AudioBuffer<float> buffer (numChannels, blockSize);
+
+    processBlocks (plugin, buffer, static_cast<int> (numSamples) / blockSize,
+        [&] (juce::AudioBuffer<float>& block, int index) {
+            for (int channel = 0; channel < numChannels; ++channel)
+                block.copyFrom (channel, 0, input[(size_t) channel].data() + index * blockSize, blockSize);
+        },
+        [&] (const juce::AudioBuffer<float>& block, int index) {
+            for (int channel = 0; channel < numChannels; ++channel)
+                std::copy (block.getReadPointer (channel), block.getReadPointer (channel) + blockSize,
+                    output[(size_t) channel].begin() + static_cast<std::ptrdiff_t> (index * blockSize));
+        });
+
+    return output;
+}
+
+// Runs code on a thread of its own, standing in for a host's audio thread, which is never the message thread
+[[maybe_unused]] static void runOnAudioThread (const std::function<void()>& code)
+{
+    std::thread audioThread (code);
+    audioThread.join();
+}
+
+// Calls due juce::Timer callbacks on this, the message thread, until condition holds. False if it never does within timeoutMs.
+[[maybe_unused]] static bool runTimersUntil (const std::function<bool()>& condition, int timeoutMs = 2000)
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32> (timeoutMs);
+
+    while (! condition())
+    {
+        if (juce::Time::getMillisecondCounter() > deadline)
+            return false;
+
+        juce::Timer::callPendingTimersSynchronously();
+        juce::Thread::sleep (1);
+    }
+
+    return true;
+}
 
 /* This is a helper function to run tests within the context of a plugin editor.
  *
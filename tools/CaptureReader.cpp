@@ -0,0 +1,139 @@
+/* Reads .sgcap analysis captures (see source/AnalysisCapture.h).
+ *
+ * The file is memory-mapped, and frames are read straight out of the mapping.
+ *
+ * Usage:
+ *   CaptureReader capture.sgcap                  header and whole-capture summary
+ *   CaptureReader capture.sgcap --csv=out.csv    one row per frame: time, open bins, mean level
+ *   CaptureReader capture.sgcap --frame=N        every bin of frame N: frequency, level, gate state
+ */
+
+#include "AnalysisCapture.h"
+
+#include <iostream>
+
+namespace
+{
+    struct FrameSummary
+    {
+        int numOpen = 0;
+        float meanDecibels = 0.0f;
+    };
+
+    FrameSummary summarise (const SpectrogramFrameRing::Frame& frame, float floorDecibels)
+    {
+        FrameSummary summary;
+        double decibelSum = 0.0;
+
+        for (int bin = 0; bin < frame.numBins; ++bin)
+        {
+            summary.numOpen += frame.isBinOpen (bin) ? 1 : 0;
+            decibelSum += AnalysisCapture::levelToDecibels (frame.levels[bin], floorDecibels);
+        }
+
+        summary.meanDecibels = frame.numBins > 0 ? static_cast<float> (decibelSum / frame.numBins) : floorDecibels;
+        return summary;
+    }
+
+    double frameSeconds (const SpectrogramFrameRing::Frame& frame, const AnalysisCapture::FileHeader& header)
+    {
+        return static_cast<double> (frame.position) / header.sampleRate;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() == 0 || args[0].isOption())
+    {
+        std::cerr << "Usage: CaptureReader capture.sgcap [--csv=out.csv] [--frame=N]" << std::endl;
+        return 1;
+    }
+
+    const auto file = args[0].resolveAsFile();
+    AnalysisCaptureReader reader (file);
+
+    if (! reader.isValid())
+    {
+        std::cerr << file.getFullPathName() << " is not a version " << AnalysisCapture::currentVersion << " capture" << std::endl;
+        return 1;
+    }
+
+    const auto& header = reader.getHeader();
+    const auto numFrames = reader.getNumFrames();
+
+    if (args.containsOption ("--frame"))
+    {
+        const auto index = args.getValueForOption ("--frame").getLargeIntValue();
+
+        if (index < 0 || index >= numFrames)
+        {
+            std::cerr << "Frame " << index << " out of range, the capture has " << numFrames << std::endl;
+            return 1;
+        }
+
+        const auto frame = reader.getFrame (index);
+        // Bins run from DC to Nyquist inclusive, so there are FFT size / 2 + 1 of them
+        const double binHz = header.sampleRate / (2.0 * juce::jmax (1, frame.numBins - 1));
+
+        std::cout << "bin,frequency_hz,level_db,open" << std::endl;
+        for (int bin = 0; bin < frame.numBins; ++bin)
+            std::cout << bin << "," << bin * binHz << "," << AnalysisCapture::levelToDecibels (frame.levels[bin], header.floorDecibels)
+                      << "," << (frame.isBinOpen (bin) ? 1 : 0) << std::endl;
+
+        return 0;
+    }
+
+    std::unique_ptr<juce::FileOutputStream> csv;
+    if (args.containsOption ("--csv"))
+    {
+        csv = std::make_unique<juce::FileOutputStream> (juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--csv")));
+
+        if (! csv->openedOk())
+        {
+            std::cerr << "Can't write " << csv->getFile().getFullPathName() << std::endl;
+            return 1;
+        }
+
+        csv->setPosition (0);
+        csv->truncate();
+        *csv << "frame,position,seconds,num_bins,hop_size,open_bins,mean_level_db\n";
+    }
+
+    double openFractionSum = 0.0;
+    int64_t gaps = 0;
+    int64_t expectedPosition = -1;
+
+    for (int64_t index = 0; index < numFrames; ++index)
+    {
+        const auto frame = reader.getFrame (index);
+        const auto summary = summarise (frame, header.floorDecibels);
+        openFractionSum += frame.numBins > 0 ? static_cast<double> (summary.numOpen) / frame.numBins : 0.0;
+
+        // Each frame ends at most its predecessor's hop later. At an Auto quality switch the first frame
+        // of the new configuration can end where the last old one did, which isn't a gap.
+        if (expectedPosition >= 0 && frame.position > expectedPosition)
+            ++gaps;
+
+        expectedPosition = frame.position + frame.hopSize;
+
+        if (csv != nullptr)
+            *csv << index << "," << frame.position << "," << frameSeconds (frame, header) << "," << frame.numBins << "," << frame.hopSize << ","
+                 << summary.numOpen << "," << summary.meanDecibels << "\n";
+    }
+
+    std::cout << file.getFileName() << std::endl
+              << "  FFT size      " << static_cast<int> (header.fftSize) << " (hop " << static_cast<int> (header.hopSize) << ") at start" << std::endl
+              << "  sample rate   " << header.sampleRate << " Hz (analysis)" << std::endl
+              << "  frames        " << numFrames << " (" << static_cast<int64_t> (header.numDropped) << " dropped, " << gaps << " gaps)" << std::endl;
+
+    if (numFrames > 0)
+    {
+        std::cout << "  duration      " << frameSeconds (reader.getFrame (numFrames - 1), header) - frameSeconds (reader.getFrame (0), header) << " s" << std::endl
+                  << "  open bins     " << 100.0 * openFractionSum / static_cast<double> (numFrames) << "% on average" << std::endl;
+    }
+
+    return 0;
+}
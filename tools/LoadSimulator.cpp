@@ -0,0 +1,412 @@
+/* Many-instance load simulator.
+ *
+ * Answers "how many spectral gates fit on this box": N PluginProcessors are
+ * driven the way a DAW drives them, and the instance count is raised until
+ * callbacks start missing their deadline (blockSize / sampleRate).
+ *
+ *   serial:   one audio thread processes every instance in turn
+ *   parallel: instances are spread over a pool of workers that run each
+ *             callback together, like a DAW processing independent tracks
+ *
+ * For each step it reports callback times, deadline misses, per-instance CPU
+ * (as a share of the deadline) and resident memory per instance. The memory is
+ * measured once at startup, before any step has grown and freed the heap, as
+ * freed arenas would otherwise be reused and hide the growth. Per-instance
+ * cost that climbs with N is usually cache pressure once the working set no
+ * longer fits in L2/L3.
+ *
+ * Usage:
+ *   LoadSimulator [--sample-rate=48000] [--block-size=128] [--fft-size=1024]
+ *                 [--threads=<cores>] [--seconds=2] [--max-instances=1024]
+ *                 [--miss-tolerance=0.001] [--mode=serial|parallel|both] [--csv=file]
+ */
+
+#include "PluginProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#if JUCE_LINUX
+    #include <unistd.h>
+#elif JUCE_MAC
+    #include <mach/mach.h>
+#elif JUCE_WINDOWS
+    #include <windows.h>
+    #include <psapi.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 128;
+        int fftSize = 1024;
+        int numThreads = 1;
+        double secondsPerStep = 2.0;
+        int maxInstances = 1024;
+        double missTolerance = 0.001;
+        bool runSerial = true;
+        bool runParallel = true;
+        juce::File csvFile;
+
+        // Resident memory one instance adds, measured once at startup (see measureBytesPerInstance)
+        double bytesPerInstance = 0.0;
+
+        double deadlineMicros() const { return 1.0e6 * blockSize / sampleRate; }
+        int numCallbacks() const { return juce::jmax(1, juce::roundToInt(secondsPerStep * sampleRate / blockSize)); }
+    };
+
+    struct StepResult
+    {
+        juce::String mode;
+        int numInstances = 0;
+        int numCallbacks = 0;
+        int numMisses = 0;
+        double meanCallbackMicros = 0.0;
+        double p99CallbackMicros = 0.0;
+        double maxCallbackMicros = 0.0;
+        double meanInstanceMicros = 0.0;
+        double bytesPerInstance = 0.0;
+
+        double missRate() const { return numCallbacks > 0 ? static_cast<double>(numMisses) / numCallbacks : 0.0; }
+    };
+
+    int64_t residentBytes()
+    {
+       #if JUCE_LINUX
+        juce::StringArray fields;
+        fields.addTokens(juce::File("/proc/self/statm").loadFileAsString(), " ", {});
+        return fields.size() > 1 ? fields[1].getLargeIntValue() * sysconf(_SC_PAGESIZE) : 0;
+       #elif JUCE_MAC
+        mach_task_basic_info info {};
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+            return 0;
+        return static_cast<int64_t>(info.resident_size);
+       #elif JUCE_WINDOWS
+        PROCESS_MEMORY_COUNTERS counters {};
+        if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof (counters)))
+            return 0;
+        return static_cast<int64_t>(counters.WorkingSetSize);
+       #else
+        return 0;
+       #endif
+    }
+
+    //==============================================================================
+    struct Instance
+    {
+        Instance(const Settings& settings, juce::Random& random)
+            : buffer(2, settings.blockSize)
+        {
+            auto& parameters = processor.getParameters();
+            const int sizeIndex = juce::jlimit(0, 5, juce::roundToInt(std::log2(settings.fftSize)) - 6);
+
+            if (auto* fftSize = parameters.getParameter("fftsize"))
+                fftSize->setValueNotifyingHost(fftSize->convertTo0to1(static_cast<float>(sizeIndex)));
+
+            processor.setPlayConfigDetails(2, 2, settings.sampleRate, settings.blockSize);
+            processor.prepareToPlay(settings.sampleRate, settings.blockSize);
+
+            for (int channel = 0; channel < 2; ++channel)
+                for (int sample = 0; sample < settings.blockSize; ++sample)
+                    input.push_back(random.nextFloat() * 0.5f - 0.25f);
+        }
+
+        // Reloads the input each time so the gate always sees signal rather than its own output
+        double process()
+        {
+            for (int channel = 0; channel < 2; ++channel)
+                buffer.copyFrom(channel, 0, input.data() + channel * buffer.getNumSamples(), buffer.getNumSamples());
+
+            const auto start = Clock::now();
+            processor.processBlock(buffer, midi);
+            return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        }
+
+        PluginProcessor processor;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        std::vector<float> input;
+        double accumulatedMicros = 0.0;
+    };
+
+    //==============================================================================
+    /* Runs one callback across a fixed set of workers. The calling thread is
+     * worker 0, the others spin on a generation counter the way realtime audio
+     * worker pools do, so there is no wake-up latency from sleeping.
+     */
+    class CallbackWorkers
+    {
+    public:
+        CallbackWorkers(int numWorkers, std::function<void(int)> workFunction)
+            : work(std::move(workFunction))
+        {
+            for (int worker = 1; worker < numWorkers; ++worker)
+                threads.emplace_back([this, worker] { workerLoop(worker); });
+        }
+
+        ~CallbackWorkers()
+        {
+            shouldExit.store(true);
+            generation.fetch_add(1);
+
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+        void runCallback()
+        {
+            remaining.store(static_cast<int>(threads.size()));
+            generation.fetch_add(1, std::memory_order_release);
+
+            work(0);
+
+            while (remaining.load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+        }
+
+    private:
+        void workerLoop(int worker)
+        {
+            uint64_t seen = 0;
+
+            for (;;)
+            {
+                uint64_t current;
+                while ((current = generation.load(std::memory_order_acquire)) == seen)
+                    std::this_thread::yield();
+
+                seen = current;
+
+                if (shouldExit.load())
+                    return;
+
+                work(worker);
+                remaining.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        std::function<void(int)> work;
+        std::vector<std::thread> threads;
+        std::atomic<uint64_t> generation { 0 };
+        std::atomic<int> remaining { 0 };
+        std::atomic<bool> shouldExit { false };
+    };
+
+    //==============================================================================
+    // Must run before any other instance exists, so the growth isn't hidden by reused heap arenas
+    double measureBytesPerInstance(const Settings& settings)
+    {
+        constexpr int numProbeInstances = 16;
+        juce::Random random(0);
+        const auto bytesBefore = residentBytes();
+
+        std::vector<std::unique_ptr<Instance>> instances;
+        instances.reserve(numProbeInstances);
+        for (int i = 0; i < numProbeInstances; ++i)
+            instances.push_back(std::make_unique<Instance>(settings, random));
+
+        return juce::jmax(0.0, static_cast<double>(residentBytes() - bytesBefore) / numProbeInstances);
+    }
+
+    StepResult runStep(const Settings& settings, int numInstances, bool parallel)
+    {
+        juce::Random random(numInstances);
+
+        std::vector<std::unique_ptr<Instance>> instances;
+        instances.reserve(static_cast<size_t>(numInstances));
+        for (int i = 0; i < numInstances; ++i)
+            instances.push_back(std::make_unique<Instance>(settings, random));
+
+        StepResult result;
+        result.mode = parallel ? "parallel" : "serial";
+        result.numInstances = numInstances;
+        result.numCallbacks = settings.numCallbacks();
+        result.bytesPerInstance = settings.bytesPerInstance;
+
+        const int numWorkers = parallel ? juce::jmin(settings.numThreads, numInstances) : 1;
+        CallbackWorkers workers(numWorkers, [&](int worker) {
+            // Round-robin so every worker gets a near equal share
+            for (size_t i = static_cast<size_t>(worker); i < instances.size(); i += static_cast<size_t>(numWorkers))
+                instances[i]->accumulatedMicros += instances[i]->process();
+        });
+
+        // Warm up the FFT pipelines and caches before measuring
+        for (int i = 0; i < 8; ++i)
+            workers.runCallback();
+
+        for (auto& instance : instances)
+            instance->accumulatedMicros = 0.0;
+
+        std::vector<double> callbackMicros;
+        callbackMicros.reserve(static_cast<size_t>(result.numCallbacks));
+        const double deadline = settings.deadlineMicros();
+
+        for (int callback = 0; callback < result.numCallbacks; ++callback)
+        {
+            const auto start = Clock::now();
+            workers.runCallback();
+            const double elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+            callbackMicros.push_back(elapsed);
+            result.numMisses += elapsed > deadline ? 1 : 0;
+        }
+
+        double totalInstanceMicros = 0.0;
+        for (auto& instance : instances)
+            totalInstanceMicros += instance->accumulatedMicros;
+
+        result.meanInstanceMicros = totalInstanceMicros / (static_cast<double>(numInstances) * result.numCallbacks);
+
+        std::sort(callbackMicros.begin(), callbackMicros.end());
+        double sum = 0.0;
+        for (auto value : callbackMicros)
+            sum += value;
+
+        result.meanCallbackMicros = sum / static_cast<double>(callbackMicros.size());
+        result.p99CallbackMicros = callbackMicros[std::min(callbackMicros.size() - 1, callbackMicros.size() * 99 / 100)];
+        result.maxCallbackMicros = callbackMicros.back();
+        return result;
+    }
+
+    void printResult(const Settings& settings, const StepResult& result)
+    {
+        const double deadline = settings.deadlineMicros();
+        std::cout << juce::String(result.mode).paddedRight(' ', 9)
+                  << juce::String(result.numInstances).paddedLeft(' ', 6)
+                  << juce::String(result.meanCallbackMicros, 1).paddedLeft(' ', 11)
+                  << juce::String(result.p99CallbackMicros, 1).paddedLeft(' ', 11)
+                  << juce::String(result.maxCallbackMicros, 1).paddedLeft(' ', 11)
+                  << juce::String(100.0 * result.missRate(), 2).paddedLeft(' ', 9)
+                  << juce::String(result.meanInstanceMicros, 2).paddedLeft(' ', 13)
+                  << juce::String(100.0 * result.meanInstanceMicros / deadline, 2).paddedLeft(' ', 10)
+                  << juce::String(result.bytesPerInstance / 1024.0, 0).paddedLeft(' ', 11)
+                  << std::endl;
+    }
+
+    // Doubles the instance count until the miss rate is exceeded, then bisects
+    int findMaxInstances(const Settings& settings, bool parallel, std::vector<StepResult>& results)
+    {
+        auto passes = [&](int numInstances) {
+            results.push_back(runStep(settings, numInstances, parallel));
+            printResult(settings, results.back());
+            return results.back().missRate() <= settings.missTolerance;
+        };
+
+        int good = 0;
+        int bad = 0;
+
+        for (int n = 1; n <= settings.maxInstances; n *= 2)
+        {
+            if (!passes(n))
+            {
+                bad = n;
+                break;
+            }
+
+            good = n;
+        }
+
+        if (bad == 0)
+            return good;
+
+        while (bad - good > 1)
+        {
+            const int middle = (good + bad) / 2;
+            (passes(middle) ? good : bad) = middle;
+        }
+
+        return good;
+    }
+
+    void writeCsv(const Settings& settings, const std::vector<StepResult>& results)
+    {
+        juce::String csv("mode,instances,sample_rate,block_size,fft_size,threads,callbacks,misses,"
+                          "mean_callback_us,p99_callback_us,max_callback_us,mean_instance_us,instance_cpu_percent,bytes_per_instance\n");
+
+        for (const auto& result : results)
+        {
+            csv << result.mode << "," << result.numInstances << "," << settings.sampleRate << "," << settings.blockSize << ","
+                << settings.fftSize << "," << (result.mode == "parallel" ? settings.numThreads : 1) << ","
+                << result.numCallbacks << "," << result.numMisses << ","
+                << result.meanCallbackMicros << "," << result.p99CallbackMicros << "," << result.maxCallbackMicros << ","
+                << result.meanInstanceMicros << "," << 100.0 * result.meanInstanceMicros / settings.deadlineMicros() << ","
+                << result.bytesPerInstance << "\n";
+        }
+
+        settings.csvFile.replaceWithText(csv);
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+    juce::ArgumentList args(argc, argv);
+
+    auto optionOr = [&](const juce::String& option, const juce::String& fallback) {
+        const auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value : fallback;
+    };
+
+    Settings settings;
+    settings.sampleRate = optionOr("--sample-rate", "48000").getDoubleValue();
+    settings.blockSize = optionOr("--block-size", "128").getIntValue();
+    settings.fftSize = optionOr("--fft-size", "1024").getIntValue();
+    settings.numThreads = optionOr("--threads", juce::String(juce::SystemStats::getNumCpus())).getIntValue();
+    settings.secondsPerStep = optionOr("--seconds", "2").getDoubleValue();
+    settings.maxInstances = optionOr("--max-instances", "1024").getIntValue();
+    settings.missTolerance = optionOr("--miss-tolerance", "0.001").getDoubleValue();
+
+    const auto mode = optionOr("--mode", "both");
+    settings.runSerial = mode != "parallel";
+    settings.runParallel = mode != "serial";
+
+    if (args.containsOption("--csv"))
+        settings.csvFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--csv"));
+
+    if (settings.sampleRate <= 0.0 || settings.blockSize <= 0 || settings.numThreads <= 0 || settings.maxInstances <= 0)
+    {
+        std::cerr << "Invalid settings, see the comment at the top of tools/LoadSimulator.cpp" << std::endl;
+        return 1;
+    }
+
+    settings.bytesPerInstance = measureBytesPerInstance(settings);
+
+    std::cout << "Spectral gate load simulator: " << settings.sampleRate << " Hz, " << settings.blockSize << " samples ("
+              << juce::String(settings.deadlineMicros(), 1) << " us deadline), FFT " << settings.fftSize << ", "
+              << settings.numThreads << " worker thread(s), " << juce::SystemStats::getCpuModel() << std::endl << std::endl;
+
+    std::cout << "mode      insts  mean(us)   p99(us)   max(us)   miss %  inst(us/blk)  inst CPU%  KB/inst" << std::endl;
+
+    std::vector<StepResult> results;
+    int maxSerial = 0;
+    int maxParallel = 0;
+
+    if (settings.runSerial)
+        maxSerial = findMaxInstances(settings, false, results);
+
+    if (settings.runParallel)
+        maxParallel = findMaxInstances(settings, true, results);
+
+    std::cout << std::endl;
+
+    if (settings.runSerial)
+        std::cout << "Max instances (serial):   " << maxSerial << std::endl;
+
+    if (settings.runParallel)
+        std::cout << "Max instances (parallel): " << maxParallel << std::endl;
+
+    if (settings.csvFile != juce::File())
+        writeCsv(settings, results);
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/* Heap allocations and lock calls per painted editor frame.
+ *
+ * Renders the same cases as the paint benchmarks: SpectrumAnalyzer, the whole
+ * editor and eight editors at once, into offscreen images at 1x and 2x scale
+ * and for every FFT size. Each frame is painted once to warm up caches such as
+ * glyphs and gradients, then once more inside a realtime_audit region
+ * (see tests/helpers/realtime_audit.h).
+ *
+ * The audit replaces operator new/delete and, on Linux/glibc, interposes malloc
+ * and the blocking calls for the whole process, so it lives in this executable
+ * and the Benchmarks timings stay uninstrumented.
+ *
+ * Usage:
+ *   PaintAllocations
+ */
+
+#include "PluginEditor.h"
+#include "helpers/realtime_audit.h"
+#include "helpers/test_helpers.h"
+
+#include <functional>
+#include <iostream>
+
+namespace
+{
+    // Quiet stereo noise, so the spectrum has content and some bins are gated
+    void prepareWithNoise (PluginProcessor& plugin, int fftSizeIndex)
+    {
+        plugin.setPlayConfigDetails (2, 2, 48000.0, 512);
+        plugin.prepareToPlay (48000.0, 512);
+        setParameter (plugin, "fftsize", static_cast<float> (fftSizeIndex));
+
+        juce::AudioBuffer<float> buffer (2, 512);
+        juce::Random random (6);
+
+        // Enough for two of the largest frames after the size switch
+        processBlocks (plugin, buffer, 16, [&] (juce::AudioBuffer<float>& input, int) { fillWithNoise (input, random, 0.05f); });
+    }
+
+    // Offscreen render target for a component at a display scale
+    struct PaintTarget
+    {
+        PaintTarget (juce::Component& componentToPaint, float scale)
+            : component (componentToPaint),
+              image (juce::Image::ARGB, juce::roundToInt (static_cast<float> (component.getWidth()) * scale),
+                     juce::roundToInt (static_cast<float> (component.getHeight()) * scale), true),
+              graphics (image)
+        {
+            graphics.addTransform (juce::AffineTransform::scale (scale));
+        }
+
+        void paintFrame() { component.paintEntireComponent (graphics, true); }
+
+        juce::Component& component;
+        juce::Image image;
+        juce::Graphics graphics;
+    };
+
+    void reportFrame (const std::string& name, const std::function<void()>& paintFrame)
+    {
+        paintFrame();
+        const auto report = realtime_audit::checkRealtimeSafety (paintFrame);
+        std::cout << name << ": " << report.describe() << " per frame" << std::endl;
+    }
+
+    std::string describeTarget (int width, int height, float scale, int fftSizeIndex)
+    {
+        return std::to_string (width) + "x" + std::to_string (height) + " @" + juce::String (scale, 1).toStdString()
+             + "x, " + std::to_string (64 << fftSizeIndex) + " FFT";
+    }
+}
+
+//==============================================================================
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    // The editor's own size, then double it for large or resized windows
+    const std::vector<std::pair<int, int>> sizes { { 880, 160 }, { 1760, 320 } };
+
+    for (int fftSizeIndex = 0; fftSizeIndex < 6; ++fftSizeIndex)
+    {
+        PluginProcessor plugin;
+        prepareWithNoise (plugin, fftSizeIndex);
+        SpectrumAnalyzer analyzer (plugin);
+
+        for (const auto& [width, height] : sizes)
+        {
+            analyzer.setSize (width, height);
+
+            for (const float scale : { 1.0f, 2.0f })
+            {
+                PaintTarget target (analyzer, scale);
+                reportFrame ("SpectrumAnalyzer paint (" + describeTarget (width, height, scale, fftSizeIndex) + ")", [&] { target.paintFrame(); });
+            }
+        }
+    }
+
+    for (int fftSizeIndex = 0; fftSizeIndex < 6; ++fftSizeIndex)
+    {
+        PluginProcessor plugin;
+        prepareWithNoise (plugin, fftSizeIndex);
+        std::unique_ptr<juce::AudioProcessorEditor> editor (plugin.createEditorIfNeeded());
+
+        for (const float scale : { 1.0f, 2.0f })
+        {
+            PaintTarget target (*editor, scale);
+            reportFrame ("PluginEditor paint (" + describeTarget (editor->getWidth(), editor->getHeight(), scale, fftSizeIndex) + ")", [&] { target.paintFrame(); });
+        }
+    }
+
+    // A session with several instances open: every editor repaints on the same message thread
+    constexpr int numEditors = 8;
+    std::vector<std::unique_ptr<PluginProcessor>> plugins;
+    std::vector<std::unique_ptr<juce::AudioProcessorEditor>> editors;
+    std::vector<std::unique_ptr<PaintTarget>> targets;
+
+    for (int i = 0; i < numEditors; ++i)
+    {
+        plugins.push_back (std::make_unique<PluginProcessor>());
+        prepareWithNoise (*plugins.back(), 4);
+        editors.emplace_back (plugins.back()->createEditorIfNeeded());
+        targets.push_back (std::make_unique<PaintTarget> (*editors.back(), 1.0f));
+    }
+
+    reportFrame (std::to_string (numEditors) + " PluginEditors paint (" + describeTarget (editors.front()->getWidth(), editors.front()->getHeight(), 1.0f, 4) + ")", [&] {
+        for (auto& target : targets)
+            target->paintFrame();
+    });
+
+    return 0;
+}